@@ -0,0 +1,82 @@
+/* gencrc - writes crctables.h, the slicing-by-8 crc tables romwak.c uses,
+ * so they are constant data instead of being built at run time.
+ * Run "make crctables" after changing anything here.
+ */
+#include <stdio.h>
+
+#define POLYNOMIAL		0x04c11db7L	/* romwak crc, msb first */
+#define ZIP_POLYNOMIAL	0xedb88320L	/* zip CRC-32, reflected */
+
+static unsigned long crc_table[8][256];
+static unsigned long zip_crc_table[8][256];
+
+/* generate the table of CRC remainders for all possible bytes; table k is
+ * the CRC of byte i followed by k zero bytes */
+static void gen_crc_table(void)
+{
+	unsigned long	crc_accum;
+	int				i, j;
+
+	for (i = 0; i < 256; i++) {
+		crc_accum = ((unsigned long)i << 24);
+		for (j = 0; j < 8; j++) {
+			if (crc_accum & 0x80000000L)
+				crc_accum = (crc_accum << 1) ^ POLYNOMIAL;
+			else
+				crc_accum = (crc_accum << 1);
+		}
+		crc_table[0][i] = crc_accum & 0xffffffffL;
+	}
+
+	/* slicing tables: push each entry through one more zero byte */
+	for (j = 1; j < 8; j++) {
+		for (i = 0; i < 256; i++) {
+			crc_accum = crc_table[j-1][i];
+			crc_table[j][i] = ((crc_accum << 8) ^ crc_table[0][crc_accum >> 24]) & 0xffffffffL;
+		}
+	}
+
+	for (i = 0; i < 256; i++) {
+		crc_accum = (unsigned long)i;
+		for (j = 0; j < 8; j++) {
+			if (crc_accum & 1)
+				crc_accum = (crc_accum >> 1) ^ ZIP_POLYNOMIAL;
+			else
+				crc_accum = (crc_accum >> 1);
+		}
+		zip_crc_table[0][i] = crc_accum;
+	}
+	for (j = 1; j < 8; j++) {
+		for (i = 0; i < 256; i++) {
+			crc_accum = zip_crc_table[j-1][i];
+			zip_crc_table[j][i] = (crc_accum >> 8) ^ zip_crc_table[0][crc_accum & 0xff];
+		}
+	}
+}
+
+static void print_table(const char *name, unsigned long table[8][256])
+{
+	int i, j;
+
+	printf("static const WORD32 %s[8][256] = {\n", name);
+	for (j = 0; j < 8; j++) {
+		printf("\t{\n");
+		for (i = 0; i < 256; i++) {
+			printf("%s0x%08lx%s", i % 8 == 0 ? "\t\t" : " ", table[j][i],
+				i == 255 ? "\n" : i % 8 == 7 ? ",\n" : ",");
+		}
+		printf(j == 7 ? "\t}\n" : "\t},\n");
+	}
+	printf("};\n");
+}
+
+int main(void)
+{
+	gen_crc_table();
+	printf("/* crc tables for romwak.c, generated by gencrc.c; don't edit */\n\n");
+	printf("/* crc_table[k][i] is the CRC of byte i followed by k zero bytes */\n");
+	print_table("crc_table", crc_table);
+	printf("\n/* same for the reflected (zip) CRC-32 */\n");
+	print_table("zip_crc_table", zip_crc_table);
+	return 0;
+}
@@ -0,0 +1,98 @@
+/* libromwak - the romwak operations, for use inside other programs.
+ *
+ * Every operation of the command line tool runs on file descriptors or
+ * memory buffers ("ports") instead of file names. Nothing is printed and
+ * nothing exits: calls return ROMWAK_OK or one of the error codes below,
+ * with errno holding the system's reason where there is one.
+ *
+ * Link with libromwak.a or libromwak.so, and -pthread.
+ */
+#ifndef LIBROMWAK_H
+#define LIBROMWAK_H
+
+/* results */
+#define ROMWAK_OK		0
+#define ROMWAK_EARGS	(-1)	/* unknown operation, bad parameters or port counts */
+#define ROMWAK_ESIZE	(-2)	/* input sizes don't suit the operation */
+#define ROMWAK_ENOMEM	(-3)	/* out of memory */
+#define ROMWAK_EREAD	(-4)	/* reading an input failed */
+#define ROMWAK_EWRITE	(-5)	/* writing an output failed; a full output buffer sets errno to ENOSPC */
+
+/* operations for RomwakRun(), with the command line option they match */
+#define ROMWAK_SPLIT_LANES	1	/* /b /w /l: 1 input, 2-8 outputs; arg1 bytes per lane (1-64) */
+#define ROMWAK_MERGE_LANES	2	/* /m /q /z /d: 2-8 inputs of one size, 1 output; arg1 bytes per lane */
+#define ROMWAK_SPLIT_HALF	3	/* /h: 1 input, 2 outputs */
+#define ROMWAK_FLIP			4	/* /f: 1 input, 1 output; arg1 bits per value (16, 32 or 64) */
+#define ROMWAK_SWAP_HALF	5	/* /s: 1 input, 1 output */
+#define ROMWAK_CONCAT		6	/* /c: 1-8 inputs, 1 output */
+#define ROMWAK_PROM_SPLIT	7	/* /e: 1-8 inputs, 2 outputs (prom gets the first 8MB, prom1 the rest) */
+#define ROMWAK_PAD			8	/* /p: 1 input, 1 output; arg1 size in bytes, arg2 pad byte */
+#define ROMWAK_UPDATE		9	/* /u: 2 inputs (patch, file), 1 output; arg1 size, arg2 offset */
+
+/* digests for RomwakDigest() */
+#define ROMWAK_DIGEST_CRC	0x01	/* romwak crc, as /i prints it */
+#define ROMWAK_DIGEST_ZIP	0x02	/* CRC-32 as used by zip and MAME dats */
+#define ROMWAK_DIGEST_MD5	0x04
+#define ROMWAK_DIGEST_SHA1	0x08
+
+/* A file descriptor (fd >= 0) or a buffer (fd = -1). Files are read from
+ * their start and outputs are written from their start and truncated, so
+ * they must be regular files; their offsets are left undefined. A buffer
+ * input holds length bytes; a buffer output has room for length bytes, and
+ * gets length set to the bytes written. */
+typedef struct {
+	int fd;
+	void *data;
+	long length;
+} RomwakPort;
+
+typedef struct {
+	unsigned long crc;
+	unsigned long zip;
+	unsigned char md5[16];
+	unsigned char sha1[20];
+	long length;			/* bytes hashed */
+} RomwakDigests;
+
+/* RomwakRun(int op, RomwakPort *in, int numIn, RomwakPort *out, int numOut, long arg1, long arg2)
+ * Run one operation. Ports are given in command line order. */
+int RomwakRun(int op, RomwakPort *in, int numIn, RomwakPort *out, int numOut, long arg1, long arg2);
+
+/* RomwakDigest(RomwakPort *in, int digests, RomwakDigests *result)
+ * Compute the ROMWAK_DIGEST_* digests asked for in one read of an input. */
+int RomwakDigest(RomwakPort *in, int digests, RomwakDigests *result);
+
+/* RomwakThreads(int threads) - Threads used per call (default: one per cpu). */
+void RomwakThreads(int threads);
+
+/* RomwakError(int code) - Short description of a result. */
+const char *RomwakError(int code);
+
+/* Requests to a romwak /serve daemon over its Unix socket. Send a
+ * RomwakRequest with its numIn input and then numOut output descriptors
+ * attached as SCM_RIGHTS (these must be files, as above); a RomwakReply comes
+ * back for each. Several requests may follow each other on one connection.
+ * ROMWAK_SERVE_DIGEST runs RomwakDigest() on one input, arg1 the digests. */
+#define ROMWAK_SERVE_DIGEST	10
+
+typedef struct {
+	int op;
+	int numIn;
+	int numOut;
+	long arg1;
+	long arg2;
+} RomwakRequest;
+
+typedef struct {
+	int status;				/* ROMWAK_OK or an error code */
+	int error;				/* errno on the daemon's side */
+	RomwakDigests digests;	/* ROMWAK_SERVE_DIGEST results */
+} RomwakReply;
+
+/* RomwakCall(int sock, const RomwakRequest *req, const int *fds, RomwakReply *reply)
+ * Send one request on a connected socket and wait for its reply. Returns the
+ * reply's status with errno set from it, or ROMWAK_EWRITE / ROMWAK_EREAD when
+ * the request couldn't be sent or no reply came. */
+int RomwakCall(int sock, const RomwakRequest *req, const int *fds, RomwakReply *reply);
+
+#endif
@@ -0,0 +1,51 @@
+/* ROMWak command line front end. The operations themselves live in romwak.c,
+ * which also builds as libromwak (see libromwak.h).
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "romwak.h"
+
+int main(int argc, char* argv[]){
+	const char *count;
+	long threads;
+
+	printf("ROMWak %s - original version by Jeff Kurtz / ANSI C port by freem / additions from ozzyouzo -\n",ROMWAK_VERSION);
+	/* -j N or -jN before the command sets the thread count */
+	while(argc >= 2 && strncmp(argv[1],"-j",2) == 0){
+		count = argv[1][2] != '\0' ? &argv[1][2] : argc >= 3 ? argv[2] : "";
+		if(!ParseLong(count,10,&threads) || threads < 1 || threads > INT_MAX){
+			printf("ERROR: Invalid thread count '%s' for -j\n\n",count);
+			Usage();
+			return EXIT_FAILURE;
+		}
+		CpuCountSet((int)threads);
+		if(argv[1][2] != '\0'){
+			argv[1] = argv[0];
+			argv++; argc--;
+		}
+		else{
+			argv[2] = argv[0];
+			argv += 2; argc -= 2;
+		}
+	}
+
+	if(argc < 2){
+		Usage();
+		return EXIT_FAILURE; /* failure to run due to no options */
+	}
+	/* kernels are picked before any command starts its threads */
+	CpuDispatchAll();
+
+	/* checked first: /b would otherwise claim it */
+	if((argv[1][0] == '/' || argv[1][0] == '-') && strcmp(&argv[1][1],"batch") == 0){
+		if(argc < 3){
+			Usage();
+			return EXIT_FAILURE;
+		}
+		return BatchFile(argv[2]);
+	}
+
+	return RunCommand(argc,argv);
+}
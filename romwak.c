@@ -1,1879 +1,6517 @@
-/* ROMWak (ANSI C port by freem, original by Jeff Kurtz)
- *
- * ROMWak was originally programmed in Delphi. This port is in ANSI C.
- * The sources given to me were of version 0.3, though I have a version 0.4
- * binary on my computer. I have not analyzed the differences between the two
- * versions, as I do not have access to Delphi build tools.
- */
-#include <stdio.h>
-#include <stdlib.h>
-
-#include "romwak.h"
-
-#define ROMWAK_VERSION	"0.7" /* derived from 0.4 source code; see above note */
-
-
-#define EIGHT_MB (8*1024*1024)
-
-/* Usage() - Print program usage. */
-void Usage(){
-	printf("usage: romwak <option> <infile> <outfile> [outfile2] [psize] [pbyte]\n");
-	printf("You must use one of these options:\n");
-	printf(" /b - Split file into two files, alternating bytes into separate files.\n");
-	printf(" /c - Concatenate two files : <infile1> <infile2> <outfile>\n");
-	printf(" /d - Darksoft concatenate crom files : <infile1> <infile2> <outfile>\n");
-	printf(" /e - Darksoft concatenate prom files : <infile1> <infile2> <outpath>\n");
-	printf(" /f - Flip low/high bytes of a file. (<outfile> optional.)\n");
-	printf(" /h - Split file in half (two files).\n");
-	printf(" /i - Generate rom information (size,crc) (as a text file).\n");
-	printf(" /m - Byte merge two files. (stores results in <outfile2>).\n");
-	printf(" /q - Byte merge four files. (See readme for syntax)\n");
-	printf(" /s - Swap top and bottom halves of a file. (<outfile2> optional.)\n");
-	printf(" /u - Byte update two files. (stores results in <outfile2>).\n");
-	printf(" /w - Split file into two files, alternating words into output files.\n");
-	printf(" /p - Pad file to [psize] in K with [pbyte] value (0-255).\n");
-	printf("\n");
-	printf("NOTE: Omission of [outfile2] will result in the second file not being saved.\n");
-	printf("\n");
-	printf("See the included README.md for more details. If README.md was not included,\n");
-	printf("please visit https://github.com/freem/romwak/\n");
-}
-/*----------------------------------------------------------------------------*/
-
-/* FileExists(char *fileIn) - Helper function to determine if a file exists.
- *
- * (Params)
- * char *fileIn			Target filename
- */
-bool FileExists(char *fileIn){
-	/* try opening file */
-	FILE *f = fopen(fileIn,"r");
-	if(f != NULL){
-		/* file open was successful, we don't need this handle. */
-		fclose(f);
-		return true;
-	}
-	/* file open unsuccessful, print error */
-	perror("Error attempting to open file");
-	return false;
-}
-/*----------------------------------------------------------------------------*/
-
-/* FileSize(FILE *pFile) - Helper function to determine a file's size.
- * Does not rewind the file, you must do it yourself.
- *
- * (Params)
- * FILE *pFile			Handle to a loaded file.
- */
-long FileSize(FILE *pFile){
-	fseek(pFile,0,SEEK_END); /* SEEK_END is non-portable, sorry */
-	return ftell(pFile);
-}
-/*----------------------------------------------------------------------------*/
-
-/* EqualSplit(char *fileIn, char *fileOutA, char *fileOutB) - /h
- * Splits a file in half equally.
- * (Get filesize, divide it by 2, and split the data. Easy enough.)
- *
- * (Params)
- * char *fileIn			Input filename
- * char *fileOutA		Output filename 1
- * char *fileOutB		Output filename 2
- */
-int EqualSplit(char *fileIn, char *fileOutA, char *fileOutB){
-	FILE *pInFile, *pOutFile1, *pOutFile2;
-	long length;
-	unsigned char *inBuffer;
-	size_t result;
-	long halfLength;
-	unsigned char *outBuf1;
-	unsigned char *outBuf2;
-	long i = 0;
-	long pos = 0;
-	unsigned char b1, b2;
-
-	if(!FileExists(fileIn)){
-		return EXIT_FAILURE;
-	}
-	printf("Splitting file '%s' equally, saving to '%s' and '%s'\n",fileIn,fileOutA,fileOutB);
-
-	pInFile = fopen(fileIn,"rb");
-	if(pInFile == NULL){
-		perror("Error attempting to open input file");
-		exit(EXIT_FAILURE);
-	}
-
-	/* find file size */
-	length = FileSize(pInFile);
-	rewind(pInFile);
-
-	/* copy data into buffer */
-	inBuffer = (unsigned char*)malloc(length);
-	if(inBuffer == NULL){
-		printf("Error allocating memory for input file buffer.");
-		exit(EXIT_FAILURE);
-	}
-
-	result = fread(inBuffer,sizeof(unsigned char),length,pInFile);
-	if(result != length){
-		perror("Error reading input file");
-		exit(EXIT_FAILURE);
-	}
-	fclose(pInFile);
-
-	/* prepare output buffers */
-	halfLength = length/2;
-	outBuf1 = (unsigned char*)malloc(halfLength);
-	if(outBuf1 == NULL){
-		printf("Error allocating memory for first output file buffer.");
-		exit(EXIT_FAILURE);
-	}
-	outBuf2 = (unsigned char*)malloc(halfLength);
-	if(outBuf2 == NULL){
-		printf("Error allocating memory for second output file buffer.");
-		exit(EXIT_FAILURE);
-	}
-
-	/* fill buffers */
-	while(i<halfLength){
-		b1 = inBuffer[i];
-		b2 = inBuffer[i+halfLength];
-		outBuf1[pos] = b1;
-		outBuf2[pos] = b2;
-		i++;
-		pos++;
-	}
-	free(inBuffer);
-
-	/* write output files */
-	pOutFile1 = fopen(fileOutA,"wb");
-	if(pOutFile1 == NULL){
-		perror("Error attempting to create first output file");
-		exit(EXIT_FAILURE);
-	}
-	result = fwrite(outBuf1,sizeof(unsigned char),halfLength,pOutFile1);
-	if(result != halfLength){
-		perror("Error writing first output file");
-		exit(EXIT_FAILURE);
-	}
-	fclose(pOutFile1);
-	printf("'%s' saved successfully!\n",fileOutA);
-	free(outBuf1);
-
-	pOutFile2 = fopen(fileOutB,"wb");
-	if(pOutFile2 == NULL){
-		perror("Error attempting to create second output file");
-		exit(EXIT_FAILURE);
-	}
-	result = fwrite(outBuf2,sizeof(unsigned char),halfLength,pOutFile2);
-	if(result != halfLength){
-		perror("Error writing second output file");
-		exit(EXIT_FAILURE);
-	}
-	fclose(pOutFile2);
-	printf("'%s' saved successfully!\n",fileOutB);
-	free(outBuf2);
-
-	return EXIT_SUCCESS;
-}
-/*----------------------------------------------------------------------------*/
-
-/* ByteSplit(char *fileIn, char *fileOutA, char *fileOutB) - /b
- *
- * (Params)
- * char *fileIn			Input filename
- * char *fileOutA		Output filename 1
- * char *fileOutB		Output filename 2
- */
-int ByteSplit(char *fileIn, char *fileOutA, char *fileOutB){
-	FILE *pInFile, *pOutFile1, *pOutFile2;
-	long length;
-	unsigned char *inBuffer;
-	size_t result;
-	long halfLength;
-	unsigned char *outBuf1;
-	unsigned char *outBuf2;
-	long i = 0;
-	long pos1 = 0;
-	long pos2 = 1;
-
-	if(!FileExists(fileIn)){
-		return EXIT_FAILURE;
-	}
-	printf("Splitting file '%s' into bytes, saving to '%s' and '%s'\n",fileIn,fileOutA,fileOutB);
-
-	pInFile = fopen(fileIn,"rb");
-	if(pInFile == NULL){
-		perror("Error attempting to open input file");
-		exit(EXIT_FAILURE);
-	}
-
-	/* find file size */
-	length = FileSize(pInFile);
-	rewind(pInFile);
-
-	/* copy data into buffer */
-	inBuffer = (unsigned char*)malloc(length);
-	if(inBuffer == NULL){
-		printf("Error allocating memory for input file buffer.");
-		exit(EXIT_FAILURE);
-	}
-
-	result = fread(inBuffer,sizeof(unsigned char),length,pInFile);
-	if(result != length){
-		perror("Error reading input file");
-		exit(EXIT_FAILURE);
-	}
-	fclose(pInFile);
-
-	/* prepare output buffers */
-	halfLength = length/2;
-	outBuf1 = (unsigned char*)malloc(halfLength);
-	if(outBuf1 == NULL){
-		printf("Error allocating memory for first output file buffer.");
-		exit(EXIT_FAILURE);
-	}
-	outBuf2 = (unsigned char*)malloc(halfLength);
-	if(outBuf2 == NULL){
-		printf("Error allocating memory for second output file buffer.");
-		exit(EXIT_FAILURE);
-	}
-
-	/* fill buffers */
-	while(i<halfLength){
-		outBuf1[i] = inBuffer[pos1];
-		outBuf2[i] = inBuffer[pos2];
-		i++;
-		pos1+=2;
-		pos2+=2;
-	}
-	free(inBuffer);
-
-	/* write output files */
-	pOutFile1 = fopen(fileOutA,"wb");
-	if(pOutFile1 == NULL){
-		perror("Error attempting to create first output file");
-		exit(EXIT_FAILURE);
-	}
-	result = fwrite(outBuf1,sizeof(unsigned char),halfLength,pOutFile1);
-	if(result != halfLength){
-		perror("Error writing first output file");
-		exit(EXIT_FAILURE);
-	}
-	fclose(pOutFile1);
-	printf("'%s' saved successfully!\n",fileOutA);
-	free(outBuf1);
-
-	pOutFile2 = fopen(fileOutB,"wb");
-	if(pOutFile2 == NULL){
-		perror("Error attempting to create second output file");
-		exit(EXIT_FAILURE);
-	}
-	result = fwrite(outBuf2,sizeof(unsigned char),halfLength,pOutFile2);
-	if(result != halfLength){
-		perror("Error writing second output file");
-		exit(EXIT_FAILURE);
-	}
-	fclose(pOutFile2);
-	printf("'%s' saved successfully!\n",fileOutB);
-	free(outBuf2);
-
-	return EXIT_SUCCESS;
-}
-/*----------------------------------------------------------------------------*/
-
-/* WordSplit(char *fileIn, char *fileOutA, char *fileOutB) - /w
- *
- * (Params)
- * char *fileIn			Input filename
- * char *fileOutA		Output filename 1
- * char *fileOutB		Output filename 2
- */
-int WordSplit(char *fileIn, char *fileOutA, char *fileOutB){
-	FILE *pInFile, *pOutFile1, *pOutFile2;
-	long length;
-	unsigned char *inBuffer;
-	size_t result;
-	long halfLength;
-	unsigned char *outBuf1;
-	unsigned char *outBuf2;
-	long i = 0;
-	long pos1 = 0;
-	long pos2 = 2;
-
-	if(!FileExists(fileIn)){
-		return EXIT_FAILURE;
-	}
-	printf("Splitting file '%s' into words, saving to '%s' and '%s'\n",fileIn,fileOutA,fileOutB);
-
-	pInFile = fopen(fileIn,"rb");
-	if(pInFile == NULL){
-		perror("Error attempting to open input file");
-		exit(EXIT_FAILURE);
-	}
-
-	/* find file size */
-	length = FileSize(pInFile);
-	rewind(pInFile);
-
-	/* copy data into buffer */
-	inBuffer = (unsigned char*)malloc(length);
-	if(inBuffer == NULL){
-		printf("Error allocating memory for input file buffer.");
-		exit(EXIT_FAILURE);
-	}
-
-	result = fread(inBuffer,sizeof(unsigned char),length,pInFile);
-	if(result != length){
-		perror("Error reading input file");
-		exit(EXIT_FAILURE);
-	}
-	fclose(pInFile);
-
-	/* prepare output buffers */
-	halfLength = length/2;
-	outBuf1 = (unsigned char*)malloc(halfLength);
-	if(outBuf1 == NULL){
-		printf("Error allocating memory for first output file buffer.");
-		exit(EXIT_FAILURE);
-	}
-	outBuf2 = (unsigned char*)malloc(halfLength);
-	if(outBuf2 == NULL){
-		printf("Error allocating memory for second output file buffer.");
-		exit(EXIT_FAILURE);
-	}
-
-	/* fill buffers */
-	while(i<halfLength){
-		outBuf1[i] = inBuffer[pos1];
-		outBuf1[i+1] = inBuffer[pos1+1];
-		outBuf2[i] = inBuffer[pos2];
-		outBuf2[i+1] = inBuffer[pos2+1];
-		i+=2;
-		pos1+=4;
-		pos2+=4;
-	}
-	free(inBuffer);
-
-	/* write output files */
-	pOutFile1 = fopen(fileOutA,"wb");
-	if(pOutFile1 == NULL){
-		perror("Error attempting to create first output file");
-		exit(EXIT_FAILURE);
-	}
-	result = fwrite(outBuf1,sizeof(unsigned char),halfLength,pOutFile1);
-	if(result != halfLength){
-		perror("Error writing first output file");
-		exit(EXIT_FAILURE);
-	}
-	fclose(pOutFile1);
-	printf("'%s' saved successfully!\n",fileOutA);
-	free(outBuf1);
-
-	pOutFile2 = fopen(fileOutB,"wb");
-	if(pOutFile2 == NULL){
-		perror("Error attempting to create second output file");
-		exit(EXIT_FAILURE);
-	}
-	result = fwrite(outBuf2,sizeof(unsigned char),halfLength,pOutFile2);
-	if(result != halfLength){
-		perror("Error writing second output file");
-		exit(EXIT_FAILURE);
-	}
-	fclose(pOutFile2);
-	printf("'%s' saved successfully!\n",fileOutB);
-	free(outBuf2);
-
-	return EXIT_SUCCESS;
-}
-/*----------------------------------------------------------------------------*/
-
-/* FlipByte(char *fileIn, char *fileOut) - /f
- * Flip low/high bytes of a file.
- *
- * (Params)
- * char *fileIn			Input filename
- * char *fileOut		Output filename
- */
-int FlipByte(char *fileIn, char *fileOut){
-	FILE *pInFile, *pOutFile;
-	long length;
-	unsigned char *buffer;
-	size_t result;
-	long i = 0;
-	unsigned char b1, b2;
-
-	if(!FileExists(fileIn)){
-		return EXIT_FAILURE;
-	}
-	/* If the second file is not passed in, flip the file in place. */
-	if(fileOut == NULL){
-		fileOut = fileIn;
-	}
-
-	printf("Flipping bytes of '%s', saving to '%s'\n",fileIn,fileOut);
-
-	pInFile = fopen(fileIn,"rb");
-	if(pInFile == NULL){
-		perror("Error attempting to open input file");
-		exit(EXIT_FAILURE);
-	}
-
-	/* find file size */
-	length = FileSize(pInFile);
-	rewind(pInFile);
-
-	/* copy data into buffer */
-	buffer = (unsigned char*)malloc(length);
-	if(buffer == NULL){
-		printf("Error allocating memory for buffer.");
-		exit(EXIT_FAILURE);
-	}
-
-	result = fread(buffer,sizeof(unsigned char),length,pInFile);
-	if(result != length){
-		perror("Error reading input file");
-		exit(EXIT_FAILURE);
-	}
-	fclose(pInFile);
-
-	/* Create new file */
-	pOutFile = fopen(fileOut,"wb");
-	if(pOutFile == NULL){
-		perror("Error attempting to create output file");
-		exit(EXIT_FAILURE);
-	}
-
-	/* flip bytes in buffer */
-	while(i<length){
-		b1 = buffer[i];
-		b2 = buffer[i+1];
-		buffer[i+1] = b1;
-		buffer[i] = b2;
-		i+=2;
-	}
-
-	/* write output file */
-	result = fwrite(buffer,sizeof(unsigned char),length,pOutFile);
-	if(result != length){
-		perror("Error writing output file");
-		exit(EXIT_FAILURE);
-	}
-	fclose(pOutFile);
-	printf("'%s' saved successfully!\n",fileOut);
-
-	free(buffer);
-	return EXIT_SUCCESS;
-}
-/*----------------------------------------------------------------------------*/
-
-/* MergeBytes(char *fileIn1, char *fileIn2, char *fileOut) - /m
- * Byte merges two files; stores result in fileOut.
- *
- * (Params)
- * char *fileIn1		Input filename 1
- * char *fileIn2		Input filename 2
- * char *fileOut		Output filename
- */
-int MergeBytes(char *fileIn1, char *fileIn2, char *fileOut){
-	FILE *pInFile1, *pInFile2, *pOutFile;
-	long length1, length2;
-	unsigned char *inBuf1;
-	unsigned char *inBuf2;
-	size_t result;
-	long outBufLen;
-	unsigned char *outBuf;
-	long i = 0;
-	long curPos = 0;
-
-	if(!FileExists(fileIn1)){
-		return EXIT_FAILURE;
-	}
-	if(!FileExists(fileIn2)){
-		return EXIT_FAILURE;
-	}
-
-	printf("Merging bytes of '%s' and '%s', saving to '%s'\n",fileIn1,fileIn2,fileOut);
-
-	/* Read file 1 */
-	pInFile1 = fopen(fileIn1,"rb");
-	if(pInFile1 == NULL){
-		perror("Error attempting to open first input file");
-		exit(EXIT_FAILURE);
-	}
-
-	/* find first file size */
-	length1 = FileSize(pInFile1);
-	rewind(pInFile1);
-
-	/* put file 1's contents into buffer */
-	inBuf1 = (unsigned char*)malloc(length1);
-	if(inBuf1 == NULL){
-		printf("Error allocating memory for input file buffer 1.");
-		exit(EXIT_FAILURE);
-	}
-
-	result = fread(inBuf1,sizeof(unsigned char),length1,pInFile1);
-	if(result != length1){
-		perror("Error reading first input file");
-		exit(EXIT_FAILURE);
-	}
-	fclose(pInFile1);
-
-	/* Read file 2 */
-	pInFile2 = fopen(fileIn2,"rb");
-	if(pInFile2 == NULL){
-		perror("Error attempting to open second input file");
-		exit(EXIT_FAILURE);
-	}
-
-	/* find second file size */
-	length2 = FileSize(pInFile2);
-	rewind(pInFile2);
-
-	/* put file 2's contents into buffer */
-	inBuf2 = (unsigned char*)malloc(length2);
-	if(inBuf2 == NULL){
-		printf("Error allocating memory for input file buffer 2.");
-		exit(EXIT_FAILURE);
-	}
-
-	result = fread(inBuf2,sizeof(unsigned char),length2,pInFile2);
-	if(result != length2){
-		perror("Error reading second input file");
-		exit(EXIT_FAILURE);
-	}
-	fclose(pInFile2);
-
-	/* Create new file */
-	pOutFile = fopen(fileOut,"wb");
-	if(pOutFile == NULL){
-		perror("Error attempting to create output file");
-		exit(EXIT_FAILURE);
-	}
-
-	/* merge bytes into a new buffer */
-	outBufLen = length1+length2;
-	outBuf = (unsigned char*)malloc(outBufLen);
-	if(outBuf == NULL){
-		printf("Error allocating memory for output file buffer.");
-		exit(EXIT_FAILURE);
-	}
-
-	while(i<length1){
-		outBuf[curPos] = inBuf1[i];
-		outBuf[curPos+1] = inBuf2[i];
-		curPos+=2;
-		i++;
-	}
-	free(inBuf1);
-	free(inBuf2);
-
-	/* write output file */
-	result = fwrite(outBuf,sizeof(unsigned char),outBufLen,pOutFile);
-	if(result != outBufLen){
-		perror("Error writing output file");
-		exit(EXIT_FAILURE);
-	}
-	fclose(pOutFile);
-	printf("'%s' saved successfully!\n",fileOut);
-
-	free(outBuf);
-	return EXIT_SUCCESS;
-}
-/*----------------------------------------------------------------------------*/
-
-/* MergeBytesQuad(char *fileIn1, char *fileIn2, char *fileIn3, char *fileIn4, char *fileOut) - /q
- * Byte merges four files; stores result in fileOut.
- *
- * (Params)
- * char *fileIn1		Input filename 1
- * char *fileIn2		Input filename 2
- * char *fileIn3		Input filename 3
- * char *fileIn4		Input filename 4
- * char *fileOut		Output filename
- */
-int MergeBytesQuad(char *fileIn1, char *fileIn2, char *fileIn3, char *fileIn4, char *fileOut){
-	FILE *pInFile1, *pInFile2, *pInFile3, *pInFile4, *pOutFile;
-	long length1, length2, length3, length4;
-	unsigned char *inBuf1;
-	unsigned char *inBuf2;
-	unsigned char *inBuf3;
-	unsigned char *inBuf4;
-	size_t result;
-	long outBufLen;
-	unsigned char *outBuf;
-	long i = 0;
-	long curPos = 0;
-
-	if(!FileExists(fileIn1)){
-		return EXIT_FAILURE;
-	}
-	if(!FileExists(fileIn2)){
-		return EXIT_FAILURE;
-	}
-	if(!FileExists(fileIn3)){
-		return EXIT_FAILURE;
-	}
-	if(!FileExists(fileIn4)){
-		return EXIT_FAILURE;
-	}
-
-	printf("Merging bytes of '%s', '%s', '%s', and '%s'; saving to '%s'\n",
-		fileIn1,fileIn2,fileIn3,fileIn4,fileOut
-	);
-
-	/* Read file 1 */
-	pInFile1 = fopen(fileIn1,"rb");
-	if(pInFile1 == NULL){
-		perror("Error attempting to open first input file");
-		exit(EXIT_FAILURE);
-	}
-
-	/* find first file size */
-	length1 = FileSize(pInFile1);
-	rewind(pInFile1);
-
-	/* put file 1's contents into buffer */
-	inBuf1 = (unsigned char*)malloc(length1);
-	if(inBuf1 == NULL){
-		printf("Error allocating memory for input file buffer 1.");
-		exit(EXIT_FAILURE);
-	}
-
-	result = fread(inBuf1,sizeof(unsigned char),length1,pInFile1);
-	if(result != length1){
-		perror("Error reading first input file");
-		exit(EXIT_FAILURE);
-	}
-	fclose(pInFile1);
-
-	/* Read file 2 */
-	pInFile2 = fopen(fileIn2,"rb");
-	if(pInFile2 == NULL){
-		perror("Error attempting to open second input file");
-		exit(EXIT_FAILURE);
-	}
-
-	/* find second file size */
-	length2 = FileSize(pInFile2);
-	rewind(pInFile2);
-
-	/* put file 2's contents into buffer */
-	inBuf2 = (unsigned char*)malloc(length2);
-	if(inBuf2 == NULL){
-		printf("Error allocating memory for input file buffer 2.");
-		exit(EXIT_FAILURE);
-	}
-
-	result = fread(inBuf2,sizeof(unsigned char),length2,pInFile2);
-	if(result != length2){
-		perror("Error reading second input file");
-		exit(EXIT_FAILURE);
-	}
-	fclose(pInFile2);
-
-	/* Read file 3 */
-	pInFile3 = fopen(fileIn3,"rb");
-	if(pInFile3 == NULL){
-		perror("Error attempting to open third input file");
-		exit(EXIT_FAILURE);
-	}
-
-	/* find third file size */
-	length3 = FileSize(pInFile3);
-	rewind(pInFile3);
-
-	/* put file 3's contents into buffer */
-	inBuf3 = (unsigned char*)malloc(length3);
-	if(inBuf3 == NULL){
-		printf("Error allocating memory for input file buffer 3.");
-		exit(EXIT_FAILURE);
-	}
-
-	result = fread(inBuf3,sizeof(unsigned char),length3,pInFile3);
-	if(result != length3){
-		perror("Error reading third input file");
-		exit(EXIT_FAILURE);
-	}
-	fclose(pInFile3);
-
-	/* Read file 4 */
-	pInFile4 = fopen(fileIn4,"rb");
-	if(pInFile4 == NULL){
-		perror("Error attempting to open fourth input file");
-		exit(EXIT_FAILURE);
-	}
-
-	/* find fourth file size */
-	length4 = FileSize(pInFile4);
-	rewind(pInFile4);
-
-	/* put file 4's contents into buffer */
-	inBuf4 = (unsigned char*)malloc(length4);
-	if(inBuf4 == NULL){
-		printf("Error allocating memory for input file buffer 4.");
-		exit(EXIT_FAILURE);
-	}
-
-	result = fread(inBuf4,sizeof(unsigned char),length4,pInFile4);
-	if(result != length4){
-		perror("Error reading fourth input file");
-		exit(EXIT_FAILURE);
-	}
-	fclose(pInFile4);
-
-	/* Create new file */
-	pOutFile = fopen(fileOut,"wb");
-	if(pOutFile == NULL){
-		perror("Error attempting to create output file");
-		exit(EXIT_FAILURE);
-	}
-
-	/* merge bytes into a new buffer */
-	outBufLen = length1+length2+length3+length4;
-	outBuf = (unsigned char*)malloc(outBufLen);
-	if(outBuf == NULL){
-		printf("Error allocating memory for output file buffer.");
-		exit(EXIT_FAILURE);
-	}
-
-	while(i<length1){
-		outBuf[curPos] = inBuf1[i];
-		outBuf[curPos+1] = inBuf2[i];
-		outBuf[curPos+2] = inBuf3[i];
-		outBuf[curPos+3] = inBuf4[i];
-		curPos+=4;
-		i++;
-	}
-	free(inBuf1);
-	free(inBuf2);
-	free(inBuf3);
-	free(inBuf4);
-
-	/* write output file */
-	result = fwrite(outBuf,sizeof(unsigned char),outBufLen,pOutFile);
-	if(result != outBufLen){
-		perror("Error writing output file");
-		exit(EXIT_FAILURE);
-	}
-	fclose(pOutFile);
-	printf("'%s' saved successfully!\n",fileOut);
-
-	free(outBuf);
-	return EXIT_SUCCESS;
-}
-/*----------------------------------------------------------------------------*/
-
-/* UpdateBytes(char *fileIn1, char *fileIn2,size_t offset, char *fileOut) - /m
- * Byte update two files; stores result in fileOut.
- * Content of fileIn1 overwrite content of fileIn2 with offset
- *
- * (Params)
- * char *fileIn1		Input filename 1
- * char *fileIn2		Input filename 2
- * char *fileOut		Output filename
- * size_t offset		Update size
-
- */
-int UpdateBytes(char *fileIn1, char *fileIn2,char *fileOut,char* updateSize) {
-	FILE *pInFile1, *pInFile2, *pOutFile;
-	long length1, length2;
-	unsigned char *inBuf1;
-	unsigned char *inBuf2;
-	size_t result;
-	long outBufLen;
-	/*unsigned char *outBuf;*/
-	long i = 0;
-	long curPos = 0;
-	size_t size;
-
-	if (updateSize != NULL) {
-		size = atol(updateSize);
-	}
-	else {
-		perror("Error need size parameter");
-		exit(EXIT_FAILURE);
-	}
-
-	if (!FileExists(fileIn1)) {
-		return EXIT_FAILURE;
-	}
-	if (!FileExists(fileIn2)) {
-		return EXIT_FAILURE;
-	}
-
-	printf("Updating (%u)bytes of '%s' to '%s, saving to '%s'\n",size, fileIn1, fileIn2, fileOut);
-
-	/* Read file 1 */
-	pInFile1 = fopen(fileIn1, "rb");
-	if (pInFile1 == NULL) {
-		perror("Error attempting to open first input file");
-		exit(EXIT_FAILURE);
-	}
-
-	/* find first file size */
-	length1 = FileSize(pInFile1);
-	rewind(pInFile1);
-
-	if (size > length1) {
-		printf("Error update size larger than file buffer 1.");
-		exit(EXIT_FAILURE);
-	}
-
-	/* put file 1's contents into buffer */
-	inBuf1 = (unsigned char*)malloc(length1);
-	if (inBuf1 == NULL) {
-		printf("Error allocating memory for input file buffer 1.");
-		exit(EXIT_FAILURE);
-	}
-
-	result = fread(inBuf1, sizeof(unsigned char), length1, pInFile1);
-	if (result != length1) {
-		perror("Error reading first input file");
-		exit(EXIT_FAILURE);
-	}
-	fclose(pInFile1);
-
-	/* Read file 2 */
-	pInFile2 = fopen(fileIn2, "rb");
-	if (pInFile2 == NULL) {
-		perror("Error attempting to open second input file");
-		exit(EXIT_FAILURE);
-	}
-
-	/* find second file size */
-	length2 = FileSize(pInFile2);
-	/*
-	if ((offset + length1) > length2) {
-		printf("Error update overflow file buffer1 size and/or offset are out bounds.");
-		exit(EXIT_FAILURE);
-	}
-	*/
-
-	rewind(pInFile2);
-
-	/* put file 2's contents into buffer */
-	inBuf2 = (unsigned char*)malloc(length2);
-	if (inBuf2 == NULL) {
-		printf("Error allocating memory for input file buffer 2.");
-		exit(EXIT_FAILURE);
-	}
-
-	result = fread(inBuf2, sizeof(unsigned char), length2, pInFile2);
-	if (result != length2) {
-		perror("Error reading second input file");
-		exit(EXIT_FAILURE);
-	}
-	fclose(pInFile2);
-
-	memcpy(inBuf2, inBuf1, size);
-
-	/* Create new file */
-	pOutFile = fopen(fileOut, "wb");
-	if (pOutFile == NULL) {
-		perror("Error attempting to create output file");
-		exit(EXIT_FAILURE);
-	}
-
-	/* write output file */
-	result = fwrite(inBuf2, sizeof(unsigned char), length2, pOutFile);
-	if (result != length2) {
-		perror("Error writing output file");
-		exit(EXIT_FAILURE);
-	}
-
-	free(inBuf1);
-	free(inBuf2);
-
-	fclose(pOutFile);
-	printf("'%s' saved successfully!\n", fileOut);
-
-	/*free(outBuf);*/
-	return EXIT_SUCCESS;
-}
-
-/*----------------------------------------------------------------------------*/
-
-/* SwapHalf(char *fileIn, char *fileOut) - /s
- * Swaps the top and bottom halves of fileIn; writes to fileOut.
- *
- * (Params)
- * char *fileIn			Input filename
- * char *fileOut		Output filename
- */
-int SwapHalf(char *fileIn, char *fileOut){
-	FILE *pInFile, *pOutFile;
-	long length, halfLength;
-	unsigned char *inBufHalf1;
-	unsigned char *inBufHalf2;
-	size_t result;
-
-	if(!FileExists(fileIn)){
-		return EXIT_FAILURE;
-	}
-	/* If the second file is not passed in, swap the file in place. */
-	if(fileOut == NULL){
-		fileOut = fileIn;
-	}
-
-	printf("Swapping halves of '%s', saving to '%s'\n",fileIn,fileOut);
-
-	pInFile = fopen(fileIn,"rb");
-	if(pInFile == NULL){
-		perror("Error attempting to open input file");
-		exit(EXIT_FAILURE);
-	}
-
-	/* find current file size */
-	length = FileSize(pInFile);
-	rewind(pInFile);
-	halfLength = length/2;
-
-	/* read halves of file into two buffers */
-	inBufHalf1 = (unsigned char*)malloc(halfLength);
-	if(inBufHalf1 == NULL){
-		printf("Error allocating memory for input file buffer 1.");
-		exit(EXIT_FAILURE);
-	}
-	result = fread(inBufHalf1,sizeof(unsigned char),halfLength,pInFile);
-	if(result != halfLength){
-		perror("Error reading input file");
-		exit(EXIT_FAILURE);
-	}
-
-	inBufHalf2 = (unsigned char*)malloc(halfLength);
-	if(inBufHalf2 == NULL){
-		printf("Error allocating memory for input file buffer 1.");
-		exit(EXIT_FAILURE);
-	}
-	result = fread(inBufHalf2,sizeof(unsigned char),halfLength,pInFile);
-	if(result != halfLength){
-		perror("Error reading input file");
-		exit(EXIT_FAILURE);
-	}
-
-	fclose(pInFile);
-
-	/* create new file from buffers written in reverse order */
-	pOutFile = fopen(fileOut,"wb");
-	if(pOutFile == NULL){
-		perror("Error attempting to create output file");
-		exit(EXIT_FAILURE);
-	}
-
-	/* write output file */
-	result = fwrite(inBufHalf2,sizeof(unsigned char),halfLength,pOutFile);
-	if(result != halfLength){
-		perror("Error writing output file");
-		exit(EXIT_FAILURE);
-	}
-	result = fwrite(inBufHalf1,sizeof(unsigned char),halfLength,pOutFile);
-	if(result != halfLength){
-		perror("Error writing output file");
-		exit(EXIT_FAILURE);
-	}
-	fclose(pOutFile);
-	printf("'%s' saved successfully!\n",fileOut);
-
-	free(inBufHalf1);
-	free(inBufHalf2);
-	return EXIT_SUCCESS;
-}
-/*----------------------------------------------------------------------------*/
-
-/* PadFile(char *fileIn, char *fileOut, char *padSize, char *padByte) - /p
- * Pads fileIn to padSize kilobytes with specified padByte; writes to fileOut.
- *
- * (Params)
- * char *fileIn			Input filename
- * char *fileOut		Output filename
- * char *padSize		Size to pad file to (in Kilobytes)
- * char *padByte		Value to pad with
- */
-int PadFile(char *fileIn, char *fileOut, char *padSize, char *padByte){
-	unsigned int shortPadSize = (atoi(padSize));
-	unsigned char padChar = (unsigned char)atoi(padByte);
-	FILE *pInFile, *pOutFile;
-	long length, fullPadSize,bufLength;
-	unsigned char *buffer;
-	size_t result;
-	long remain, bufPos;
-	long i = 0;
-
-	if(!FileExists(fileIn)){
-		return EXIT_FAILURE;
-	}
-
-	printf("Padding '%s' to %d kilobytes with byte 0x%02X, saving to '%s'\n",
-		fileIn,shortPadSize,padChar,fileOut);
-
-	pInFile = fopen(fileIn,"rb");
-	if(pInFile == NULL){
-		perror("Error attempting to open input file");
-		exit(EXIT_FAILURE);
-	}
-
-	/* find current file size */
-	length = FileSize(pInFile);
-	rewind(pInFile);
-
-	/* copy data into buffer */
-	fullPadSize = shortPadSize*1024;
-	bufLength = fullPadSize;
-	buffer = (unsigned char*)malloc(bufLength);
-	if(buffer == NULL){
-		printf("Error allocating memory for input file buffer.");
-		exit(EXIT_FAILURE);
-	}
-
-	result = fread(buffer,sizeof(unsigned char),length,pInFile);
-	if(result != length){
-		perror("Error reading input file");
-		exit(EXIT_FAILURE);
-	}
-
-	fclose(pInFile);
-
-	/* add padding to buffer */
-	remain = fullPadSize-(sizeof(unsigned char)*length);
-	bufPos = result;
-	while(i<remain){
-		buffer[bufPos] = padChar;
-		bufPos++;
-		i++;
-	}
-
-	/* create new file with padding */
-	pOutFile = fopen(fileOut,"wb");
-	if(pOutFile == NULL){
-		perror("Error attempting to create output file");
-		exit(EXIT_FAILURE);
-	}
-
-	/* write output file */
-	result = fwrite(buffer,sizeof(unsigned char),bufLength,pOutFile);
-	if(result != bufLength){
-		perror("Error writing output file");
-		exit(EXIT_FAILURE);
-	}
-	fclose(pOutFile);
-	printf("'%s' saved successfully!\n",fileOut);
-
-	free(buffer);
-	return EXIT_SUCCESS;
-}
-/*----------------------------------------------------------------------------*/
-
-/* ConcatFiles(char *fileIn, char *fileOutA, char *fileOutB) - /b
- *
- * (Params)
- * char *fileInA			Input filename 1
- * char *fileInB			Input filename 2
- * char *fileOut			Output filename 
- *
- * OzzyOuzo   note: bored to mess up with system commands thus better to get it included into romwak
- *			  pretty useful to generate appropriate P roms when using bank switching.
- */
-
- /* #define USE_PRINTF_ERRORS */
-int ConcatFiles(char *fileInA_, char *fileInB_, char *fileOut_)
-{
-	FILE *pInFileA, *pInFileB, *pOutFile;
-	long sizeA,sizeB;
-	unsigned char *inBufA,*inBufB;
-	size_t result;
-
-	if (!FileExists(fileInA_) || !FileExists(fileInB_)) {
-		#ifdef USE_PRINTF_ERRORS
-		printf("Error input file not found\n");
-		#endif
-		return EXIT_FAILURE;
-	}
-
-
-	/* file A */
-
-	pInFileA = fopen(fileInA_, "rb");
-	if (pInFileA == NULL) {
-		#ifdef USE_PRINTF_ERRORS
-		printf("Error attempting to open input file A\n");
-		#endif
-		perror("Error attempting to open input file A");
-		exit(EXIT_FAILURE);
-	}
-
-	sizeA = FileSize(pInFileA);
-	fseek(pInFileA, 0, SEEK_SET);
-
-	if (!sizeA) {
-		#ifdef USE_PRINTF_ERRORS
-		printf("Error empty file A\n");
-		#endif
-		perror("Error empty file A");
-		exit(EXIT_FAILURE);
-	}
-
-	inBufA = (unsigned char*)malloc(sizeA);
-	if (inBufA == NULL){
-		#ifdef USE_PRINTF_ERRORS
-		printf("Error allocating memory for input file A buffer.\n");
-		#endif
-		perror("Error allocating memory for input file A buffer.");
-		exit(EXIT_FAILURE);
-	}
-
-	result = fread(inBufA, sizeof(unsigned char),sizeA, pInFileA);
-	if (result != sizeA){
-		#ifdef USE_PRINTF_ERRORS
-		printf("Error reading input file A\n");
-		#endif
-		perror("Error reading input file A");
-		exit(EXIT_FAILURE);
-	}
-	fclose(pInFileA);
-
-	/* file B */
-
-	pInFileB = fopen(fileInB_, "rb");
-	if (pInFileB == NULL) {
-		#ifdef USE_PRINTF_ERRORS
-		printf("Error attempting to open input file B\n");
-		#endif
-		perror("Error attempting to open input file B");
-		exit(EXIT_FAILURE);
-	}
-
-	sizeB = FileSize(pInFileB);
-	fseek(pInFileB, 0, SEEK_SET);
-
-	if (!sizeB) {
-		#ifdef USE_PRINTF_ERRORS
-		printf("Error empty file B\n");
-		#endif
-		perror("Error empty file B");
-		exit(EXIT_FAILURE);
-	}
-
-	inBufB = (unsigned char*)malloc(sizeB);
-	if (inBufB == NULL) {
-		#ifdef USE_PRINTF_ERRORS	
-		printf("Error allocating memory for input file B buffer.\n");
-		#endif
-		perror("Error allocating memory for input file B buffer.");
-		exit(EXIT_FAILURE);
-	}
-	
-	result = fread(inBufB, sizeof(unsigned char), sizeB, pInFileB);
-	if (result != sizeB) {
-		#ifdef USE_PRINTF_ERRORS	
-		printf("Error reading input file B\n");
-		#endif
-		perror("Error reading input file B");
-		exit(EXIT_FAILURE);
-	}
-	fclose(pInFileB);
-
-	/* create concatened file */
-	pOutFile = fopen(fileOut_, "wb");
-	if (pOutFile == NULL) {
-		#ifdef USE_PRINTF_ERRORS	
-		printf("Error attempting to create output file\n");
-		#endif
-		perror("Error attempting to create output file");
-		exit(EXIT_FAILURE);
-	}
-
-	result = fwrite(inBufA, sizeof(unsigned char), sizeA, pOutFile);
-	if (result != sizeA) {
-		#ifdef USE_PRINTF_ERRORS	
-		printf("Error writing part A of output file\n");
-		#endif
-		perror("Error writing part A of output file");
-		exit(EXIT_FAILURE);
-	}
-
-	result = fwrite(inBufB, sizeof(unsigned char), sizeB, pOutFile);
-	if (result != sizeB) {
-		#ifdef USE_PRINTF_ERRORS	
-		printf("Error writing part B of output file\n");
-		#endif
-		perror("Error writing part B of output file");
-		exit(EXIT_FAILURE);
-	}
-
-	fclose(pOutFile);
-
-	printf("'%s' + '%s' concatained into '%s' successfully!\n", fileInA_, fileInB_, fileOut_);
-
-	free(inBufA);
-	free(inBufB);
-	return EXIT_SUCCESS;
-}
-
-/* ConcatFilesEx(char *fileIn, char *fileOutA, char *fileOutB) - /b
- *
- * (Params)
- * char *fileInA			Input filename 1
- * char *fileInB			Input filename 2
- * char *pathOut			Output path for generated prom and prom1 files.
- *
- * OzzyOuzo   note: Darksoft special concatenation for proms files.
- *
- */
-
- /*
- example for teot:
-
-copy teot-m1.bin p:\foo\darksoft\m1rom
-copy teot-s1.bin p:\foo\darksoft\srom
-romwak /e teot-p1.bin teot-p2.bin p:\foo\darksoft
-romwak /c teot-v1.bin teot-v2.bin p:\foo\darksoft\vroma0
-romwak /d teot-c1.bin teot-c2.bin p:\foo\darksoft\crom0
-
- as it is using a MiSter core format you'll need to add a text file containing 2 to 3 digits called:fpga
- into the generated roms directory.
-
- 1st digit indicates bankswitching mode:
- ---------------------------------------
- 0 = no bankswitching
- 1 = standard bankswitching
- 2 = neo-pvc bankswitching (F9 & F8)
- 3 = neo-sma KOF99 bankswitching
- 4 = neo-sma Garou "KF" version bankswitching
- 5 = neo-sma Garou "KE" version bankswitching
- 6 = neo-sma Metal Slug 3 bankswitching
- 7 = neo-sma KOF2000 bankswitching
-
- 2nd digit indicates graphics mode:
- ----------------------------------
- 0 = CROM full address
- 1 = CROM zero 1 MSB
- 2 = CROM zero 2 MSBs
- 3 = CROM zero 3 MSBs
- 4 = CROM zero 4 MSBs
- 5 = NEO-CMC SROM bankswitching (42 version)
- 6 = NEO-CMC SROM bankswitching (50 version)
-
- 3rd digit indicates audio mode:
- -------------------------------
- 0 = VROM+PCM mode
- 1 = VROMA/VROMB mode
-
- generally the value:10 is working fine.
-
-
-
- /* #define USE_PRINTF_ERRORS */
-int ConcatFilesEx(char* fileInA_, char* fileInB_, char* pathOut_)
-{
-	FILE* pInFileA, * pInFileB, * pOutFile;
-	long sizeA, sizeB, sizeC, finalSize;
-	unsigned char* inBufA, * inBufB;
-	size_t result;
-	char fileOut[8192];
-
-	if (!FileExists(fileInA_) || !FileExists(fileInB_)) {
-		#ifdef USE_PRINTF_ERRORS
-		printf("Error input file not found\n");
-		#endif
-		return EXIT_FAILURE;
-	}
-
-
-	/* file A */
-
-	pInFileA = fopen(fileInA_, "rb");
-	if (pInFileA == NULL) {
-		#ifdef USE_PRINTF_ERRORS
-		printf("Error attempting to open input file A\n");
-		#endif
-		perror("Error attempting to open input file A");
-		exit(EXIT_FAILURE);
-	}
-
-	sizeA = FileSize(pInFileA);
-	fseek(pInFileA, 0, SEEK_SET);
-
-	if (!sizeA) {
-		#ifdef USE_PRINTF_ERRORS
-		printf("Error empty file A\n");
-		#endif
-		perror("Error empty file A");
-		exit(EXIT_FAILURE);
-	}
-
-	inBufA = (unsigned char*)malloc(sizeA);
-	if (inBufA == NULL) {
-		#ifdef USE_PRINTF_ERRORS
-		printf("Error allocating memory for input file A buffer.\n");
-		#endif
-		perror("Error allocating memory for input file A buffer.");
-		exit(EXIT_FAILURE);
-	}
-
-	result = fread(inBufA, sizeof(unsigned char), sizeA, pInFileA);
-	if (result != sizeA) {
-		#ifdef USE_PRINTF_ERRORS
-		printf("Error reading input file A\n");
-		#endif
-		perror("Error reading input file A");
-		exit(EXIT_FAILURE);
-	}
-	fclose(pInFileA);
-
-	/* file B */
-
-	pInFileB = fopen(fileInB_, "rb");
-	if (pInFileB == NULL) {
-		#ifdef USE_PRINTF_ERRORS
-		printf("Error attempting to open input file B\n");
-		#endif
-		perror("Error attempting to open input file B");
-		exit(EXIT_FAILURE);
-	}
-
-	sizeB = FileSize(pInFileB);
-	fseek(pInFileB, 0, SEEK_SET);
-
-	if (!sizeB) {
-		#ifdef USE_PRINTF_ERRORS
-		printf("Error empty file B\n");
-		#endif
-		perror("Error empty file B");
-		exit(EXIT_FAILURE);
-	}
-
-	inBufB = (unsigned char*)malloc(sizeB);
-	if (inBufB == NULL) {
-		#ifdef USE_PRINTF_ERRORS	
-		printf("Error allocating memory for input file B buffer.\n");
-		#endif
-		perror("Error allocating memory for input file B buffer.");
-		exit(EXIT_FAILURE);
-	}
-
-	result = fread(inBufB, sizeof(unsigned char), sizeB, pInFileB);
-	if (result != sizeB) {
-		#ifdef USE_PRINTF_ERRORS	
-		printf("Error reading input file B\n");
-		#endif
-		perror("Error reading input file B");
-		exit(EXIT_FAILURE);
-	}
-	fclose(pInFileB);
-
-	/* create concatened files */
-
-	sprintf(fileOut,"%s/prom",pathOut_);
-
-	pOutFile = fopen(fileOut, "wb");
-	if (pOutFile == NULL) {
-		#ifdef USE_PRINTF_ERRORS	
-		printf("Error attempting to create prom file\n");
-		#endif
-		perror("Error attempting to create prom file");
-		exit(EXIT_FAILURE);
-	}
-
-	if (sizeA > EIGHT_MB) {
-		finalSize = EIGHT_MB;
-	}
-	else {
-		finalSize = sizeA;
-	}
-
-	result = fwrite(inBufA, sizeof(unsigned char), finalSize, pOutFile);
-	if (result != finalSize) {
-		#ifdef USE_PRINTF_ERRORS	
-		printf("Error writing part A of prom file\n");
-		#endif
-		perror("Error writing part A of prom file");
-		exit(EXIT_FAILURE);
-	}
-
-	if (sizeA > EIGHT_MB) {
-		fclose(pOutFile);
-
-		sprintf(fileOut, "%s/prom1", pathOut_);
-
-		pOutFile = fopen(fileOut, "wb");
-		if (pOutFile == NULL) {
-			#ifdef USE_PRINTF_ERRORS	
-			printf("Error attempting to create prom1 file\n");
-			#endif
-			perror("Error attempting to create prom1 file");
-			exit(EXIT_FAILURE);
-		}
-
-		finalSize = sizeA - finalSize;
-
-		result = fwrite(inBufA, sizeof(unsigned char), finalSize, pOutFile);
-		if (result != finalSize) {
-			#ifdef USE_PRINTF_ERRORS	
-			printf("Error writing part A of prom1 file\n");
-			#endif
-			perror("Error writing part A of prom1 file");
-			exit(EXIT_FAILURE);
-		}
-	}
-	else {
-		sizeC = sizeA + sizeB;
-		if (sizeC > EIGHT_MB) {
-			finalSize = sizeC - EIGHT_MB;
-			sizeB -= finalSize;
-		}
-	}
-
-	result = fwrite(inBufB, sizeof(unsigned char), sizeB, pOutFile);
-	if (result != sizeB) {
-		if (sizeA > EIGHT_MB) {
-			#ifdef USE_PRINTF_ERRORS	
-			printf("Error writing part B of prom1 file\n");
-			#endif
-			perror("Error writing part B of prom1 file");
-		}
-		else {
-			#ifdef USE_PRINTF_ERRORS	
-			printf("Error writing part B of prom file\n");
-			#endif
-			perror("Error writing part B of prom file");
-		}
-		exit(EXIT_FAILURE);
-	
-
-	}
-
-	if (sizeC > EIGHT_MB && sizeA <= EIGHT_MB) {
-		fclose(pOutFile);
-
-		sprintf(fileOut, "%s/prom1", pathOut_);
-
-		pOutFile = fopen(fileOut, "wb");
-		if (pOutFile == NULL) {
-			#ifdef USE_PRINTF_ERRORS	
-			printf("Error attempting to create prom1 file\n");
-			#endif
-			perror("Error attempting to create prom1 file");
-			exit(EXIT_FAILURE);
-		}
-
-		result = fwrite(&inBufB[sizeB], sizeof(unsigned char), finalSize, pOutFile);
-		if (result != finalSize) {
-			#ifdef USE_PRINTF_ERRORS	
-			printf("Error writing prom1 file\n");
-			#endif
-			perror("Error writing prom1 file");
-			exit(EXIT_FAILURE);
-		}
-	}
-
-	fclose(pOutFile);
-
-	printf("'%s' + '%s' concatained into prom ",fileInA_,fileInB_);
-	if (sizeC > EIGHT_MB || sizeA > EIGHT_MB) {
-		printf("and prom1 ");
-	}
-		
-	printf("successfully!\n");
-
-	free(inBufA);
-	free(inBufB);
-	return EXIT_SUCCESS;
-}
-
-
-/* DarksoftConcatFiles(char *fileIn, char *fileOutA, char *fileOutB) - /b
- *
- * (Params)
- * char *fileInA			Input filename 1
- * char *fileInB			Input filename 2
- * char *fileOut			Output filename
- *
- * OzzyOuzo   note: Darksoft special word concatenation for croms files.
- *
- */
-
- /*
- example for cyborgForce:
-
- copy cyborg-m1.bin p:\foo\Darksoft\cyborgf\m1rom
- copy cyborg-s1.bin p:\foo\Darksoft\cyborgf\srom
- romwak /c cyborg-p1.bin cyborg-p2.bin p:\foo\Darksoft\cyborgf\prom
- romwak /c cyborg-v1.bin cyborg-v2.bin p:\foo\Darksoft\cyborgf\vroma0
- romwak /d cyborg-c1.bin cyborg-c2.bin p:\foo\Darksoft\cyborgf\crom0
-
- as it is using a MiSter core format you'll need to add a text file containing 2 to 3 digits called:fpga
- into the generated roms directory.
-
- 1st digit indicates bankswitching mode:
- ---------------------------------------
- 0 = no bankswitching
- 1 = standard bankswitching
- 2 = neo-pvc bankswitching (F9 & F8)
- 3 = neo-sma KOF99 bankswitching
- 4 = neo-sma Garou "KF" version bankswitching
- 5 = neo-sma Garou "KE" version bankswitching
- 6 = neo-sma Metal Slug 3 bankswitching
- 7 = neo-sma KOF2000 bankswitching
-
- 2nd digit indicates graphics mode:
- ----------------------------------
- 0 = CROM full address
- 1 = CROM zero 1 MSB
- 2 = CROM zero 2 MSBs
- 3 = CROM zero 3 MSBs
- 4 = CROM zero 4 MSBs
- 5 = NEO-CMC SROM bankswitching (42 version)
- 6 = NEO-CMC SROM bankswitching (50 version)
-
- 3rd digit indicates audio mode:
- -------------------------------
- 0 = VROM+PCM mode
- 1 = VROMA/VROMB mode
-
- generally the value:10 is working fine.
-
- */
-
- /* #define USE_PRINTF_ERRORS */
-int DarksoftConcatFiles(char* fileInA_, char* fileInB_, char* fileOut_)
-{
-	FILE* pInFileA, * pInFileB, * pOutFile;
-	long i, sizeA, sizeB, sizeC;
-	unsigned char* inBufA, * inBufB, * inBufC;
-	size_t result;
-	unsigned short* ptrA, * ptrB, * ptrC;
-
-	if (!FileExists(fileInA_) || !FileExists(fileInB_)) {
-		#ifdef USE_PRINTF_ERRORS
-		printf("Error input file not found\n");
-		#endif
-		return EXIT_FAILURE;
-	}
-
-
-	/* file A */
-
-	pInFileA = fopen(fileInA_, "rb");
-	if (pInFileA == NULL) {
-		#ifdef USE_PRINTF_ERRORS
-		printf("Error attempting to open input file A\n");
-		#endif
-		perror("Error attempting to open input file A");
-		exit(EXIT_FAILURE);
-	}
-
-	sizeA = FileSize(pInFileA);
-	fseek(pInFileA, 0, SEEK_SET);
-
-	if (!sizeA) {
-		#ifdef USE_PRINTF_ERRORS
-		printf("Error empty file A\n");
-		#endif
-		perror("Error empty file A");
-		exit(EXIT_FAILURE);
-	}
-
-	inBufA = (unsigned char*)malloc(sizeA);
-	if (inBufA == NULL) {
-		#ifdef USE_PRINTF_ERRORS
-		printf("Error allocating memory for input file A buffer.\n");
-		#endif
-		perror("Error allocating memory for input file A buffer.");
-		exit(EXIT_FAILURE);
-	}
-
-	result = fread(inBufA, sizeof(unsigned char), sizeA, pInFileA);
-	if (result != sizeA) {
-		#ifdef USE_PRINTF_ERRORS
-		printf("Error reading input file A\n");
-		#endif
-		perror("Error reading input file A");
-		exit(EXIT_FAILURE);
-	}
-	fclose(pInFileA);
-
-	/* file B */
-
-	pInFileB = fopen(fileInB_, "rb");
-	if (pInFileB == NULL) {
-		#ifdef USE_PRINTF_ERRORS
-		printf("Error attempting to open input file B\n");
-		#endif
-		perror("Error attempting to open input file B");
-		exit(EXIT_FAILURE);
-	}
-
-	sizeB = FileSize(pInFileB);
-	fseek(pInFileB, 0, SEEK_SET);
-
-	if (!sizeB) {
-		#ifdef USE_PRINTF_ERRORS
-		printf("Error empty file B\n");
-		#endif
-		perror("Error empty file B");
-		exit(EXIT_FAILURE);
-	}
-
-	inBufB = (unsigned char*)malloc(sizeB);
-	if (inBufB == NULL) {
-		#ifdef USE_PRINTF_ERRORS	
-		printf("Error allocating memory for input file B buffer.\n");
-		#endif
-		perror("Error allocating memory for input file B buffer.");
-		exit(EXIT_FAILURE);
-	}
-
-	result = fread(inBufB, sizeof(unsigned char), sizeB, pInFileB);
-	if (result != sizeB) {
-		#ifdef USE_PRINTF_ERRORS	
-		printf("Error reading input file B\n");
-		#endif
-		perror("Error reading input file B");
-		exit(EXIT_FAILURE);
-	}
-	fclose(pInFileB);
-
-	sizeC = sizeA + sizeB;
-
-	inBufC = (unsigned char*)malloc(sizeC);
-	if (inBufC == NULL) {
-		#ifdef USE_PRINTF_ERRORS	
-		printf("Error allocating memory for input file C buffer.\n");
-		#endif
-		perror("Error allocating memory for input file C buffer.");
-		exit(EXIT_FAILURE);
-	}
-
-	ptrA = (unsigned short*)inBufA;
-	ptrB = (unsigned short*)inBufB;
-	ptrC = (unsigned short*)inBufC;
-
-	for (i = 0; i < sizeC; i += 4) {
-		*ptrC++ = *ptrA++;
-		*ptrC++ = *ptrB++;
-	}
-
-	/* create concatened file */
-	pOutFile = fopen(fileOut_, "wb");
-	if (pOutFile == NULL) {
-		#ifdef USE_PRINTF_ERRORS	
-		printf("Error attempting to create output file\n");
-		#endif
-		perror("Error attempting to create output file");
-		exit(EXIT_FAILURE);
-	}
-
-	result = fwrite(inBufC, sizeof(unsigned char), sizeC, pOutFile);
-	if (result != sizeC) {
-		#ifdef USE_PRINTF_ERRORS	
-		printf("Error writing output file\n");
-		#endif
-		perror("Error writing output file");
-		exit(EXIT_FAILURE);
-	}
-
-	fclose(pOutFile);
-
-	printf("'%s' + '%s' darksoft concataination into '%s' successfully!\n", fileInA_, fileInB_, fileOut_);
-
-	free(inBufA);
-	free(inBufB);
-	free(inBufC);
-	return EXIT_SUCCESS;
-}
-
-
-/*----------------------------------------------------------------------------*/
-
-typedef unsigned short CRC16;
-typedef unsigned long CRC32;
-
-#define POLYNOMIAL 0x04c11db7L
-
-static unsigned long crc_table[256];
-
-/* generate the table of CRC remainders for all possible bytes */
-void gen_crc_table(void)
-{
-	register unsigned long	crc_accum;
-	register int			i, j;
-
-	for (i = 0; i < 256; i++) {
-		crc_accum = ((unsigned long)i << 24);
-		for (j = 0; j < 8; j++) {
-			if (crc_accum & 0x80000000L)
-				crc_accum = (crc_accum << 1) ^ POLYNOMIAL;
-			else
-				crc_accum = (crc_accum << 1);
-		}
-		crc_table[i] = crc_accum;
-	}
-	//	return;
-}
-
-/* update the CRC on the data block one byte at a time */
-CRC32 update_crc(unsigned long crc_accum, char * data_blk_ptr, int data_blk_size)
-{
-	register int	i, j;
-
-	for (j = 0; j < data_blk_size; j++) {
-		i = ((int)(crc_accum >> 24) ^ *data_blk_ptr++) & 0xff;
-		crc_accum = (crc_accum << 8) ^ crc_table[i];
-	}
-
-	return crc_accum;
-}
-
-// ....
-void crc32Init(void)
-{
-	gen_crc_table();
-}
-
-// ....
-CRC32 crc32GenerateKey(unsigned long crc_accum, char * p_data, int data_size)
-{
-	return update_crc(crc_accum, p_data, data_size);
-}
-
-/*----------------------------------------------------------------------------*/
-
-
-/* SwapHalf(char *fileIn, char *fileOut) - /s
- * Swaps the top and bottom halves of fileIn; writes to fileOut.
- *
- * (Params)
- * char *fileIn			Input filename
- * char *fileOut		Output filename (text)
- */
-int InfoFile(char *fileIn, char *fileOut) {
-	FILE *pInFile, *pOutFile;
-	long length;
-	CRC32 crc;
-	unsigned char *inBuf;
-	size_t result,nb;
-
-	if (!FileExists(fileIn)) {
-		return EXIT_FAILURE;
-	}
-	printf("Generating file informations of '%s', saving to '%s'\n", fileIn, fileOut);
-
-	pInFile = fopen(fileIn, "rb");
-	if (pInFile == NULL) {
-		perror("Error attempting to open input file");
-		exit(EXIT_FAILURE);
-	}
-
-	/* find current file size */
-	length = FileSize(pInFile);
-	rewind(pInFile);
-
-	/* read halves of file into two buffers */
-	inBuf = (unsigned char*)malloc(length);
-
-	if (inBuf == NULL) {
-		printf("Error allocating memory for input file buffer.");
-		exit(EXIT_FAILURE);
-	}
-
-	nb = fread(inBuf,1,length, pInFile);
-	if (nb != length){
-		perror("Error reading input file");
-		exit(EXIT_FAILURE);
-	}
-
-	fclose(pInFile);
-
-	crc32Init();
-
-	crc = crc32GenerateKey(0,inBuf,length);
-	
-
-	/* create new text file containing rom size and crc informations */
-	pOutFile = fopen(fileOut, "wt");
-	if (pOutFile == NULL) {
-		perror("Error attempting to create output file");
-		exit(EXIT_FAILURE);
-	}
-
-	fprintf(pOutFile, "%s size:%u crc32:0x%x", fileIn, length, crc);
-	printf("%s size:%u , crc:0x%x", fileIn, length, crc);
-
-	fclose(pOutFile);
-	printf("'%s' saved successfully!\n", fileOut);
-
-	free(inBuf);
-	return EXIT_SUCCESS;
-}
-
-/*----------------------------------------------------------------------------*/
-
-/* ye olde main */
-int main(int argc, char* argv[]){
-	printf("ROMWak %s - original version by Jeff Kurtz / ANSI C port by freem / additions from ozzyouzo -\n",ROMWAK_VERSION);
-	if(argc < 2){
-		Usage();
-		return EXIT_FAILURE; /* failure to run due to no options */
-	}
-
-	/* command line argument parsing (originally in ROMWAK.DPR) */
-	/* The original program used /switches, but this port allows shorthand
-	 * switches with a '-' as well, for people who aren't on Windows. */
-	if(argv[1][0] != '/' && argv[1][0] != '-'){
-		printf("ERROR: Invalid command %s\n\n",argv[1]);
-		Usage();
-		return EXIT_FAILURE; /* command syntax is wrong, broheim */
-	}
-	else{
-		switch(argv[1][1]){
-			case 'b': /* split file in two, alternating bytes */
-				return ByteSplit(argv[2],argv[3],argv[4]);
-
-			case 'c': /* concatenate two file2 */
-				return ConcatFiles(argv[2], argv[3], argv[4]);
-
-			case 'd': /* concatenate crom files ala Darksoft */
-				return DarksoftConcatFiles(argv[2], argv[3], argv[4]);
-
-			case 'e': /* concatenate prom files ala Darksoft */
-				return ConcatFilesEx(argv[2], argv[3], argv[4]);
-
-			case 'f': /* flip low/high bytes */
-				return FlipByte(argv[2],argv[3]);
-
-			case 'h': /* split file in half (two files) */
-				return EqualSplit(argv[2],argv[3],argv[4]);
-
-			case 'i': /* rom information (size,crc) */
-				return InfoFile(argv[2], argv[3]);
-
-			case 'm': /* byte merge two files */
-				return MergeBytes(argv[2],argv[3],argv[4]);
-
-			case 'q': /* byte merge four files */
-				return MergeBytesQuad(argv[2],argv[3],argv[4],argv[5],argv[6]);
-
-			case 's': /* swap top and bottom halves of a file */
-				return SwapHalf(argv[2],argv[3]);
-
-			case 'u': /* byte update two files with size */
-				return UpdateBytes(argv[2], argv[3], argv[4], argv[5]);
-
-			case 'w': /* split file in two, alternating words */
-				return WordSplit(argv[2],argv[3],argv[4]);
-
-			case 'p': /* pad file */
-				return PadFile(argv[2],argv[3],argv[4],argv[5]);
-
-			default:
-				/* option does not exist */
-				printf("ERROR: Option '/%c' doesn't exist.\n",argv[1][1]);
-				return EXIT_FAILURE;
-		}
-	}
-
-	/* should not get here, but if it does, let's not make a fuss. */
-	return EXIT_SUCCESS;
-}
+/* ROMWak (ANSI C port by freem, original by Jeff Kurtz)
+ *
+ * ROMWak was originally programmed in Delphi. This port is in ANSI C.
+ * The sources given to me were of version 0.3, though I have a version 0.4
+ * binary on my computer. I have not analyzed the differences between the two
+ * versions, as I do not have access to Delphi build tools.
+ */
+#if defined(__linux__)
+#define _GNU_SOURCE
+#elif defined(__unix__) || defined(__APPLE__)
+#define _POSIX_C_SOURCE 200112L
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define ROMWAK_POSIX
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <fcntl.h>
+#endif
+
+#if defined(__linux__)
+#define ROMWAK_LINUX
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#endif
+
+#if defined(ROMWAK_LINUX) && defined(__NR_io_uring_setup) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define ROMWAK_URING
+#include <linux/io_uring.h>
+#include <sys/uio.h>
+#endif
+#endif
+
+#if defined(_WIN32)
+#include <io.h>
+#include <direct.h>
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define ROMWAK_X86
+#include <immintrin.h>
+#endif
+
+#if defined(__GNUC__) && defined(__ARM_NEON)
+#define ROMWAK_NEON
+#include <arm_neon.h>
+#if defined(__aarch64__) && defined(__linux__)
+#define ROMWAK_PMULL
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+#endif
+
+#include "romwak.h"
+#include "libromwak.h"
+
+
+#define EIGHT_MB (8*1024*1024)
+
+/* Usage() - Print program usage. */
+void Usage(){
+	printf("usage: romwak [-j threads] <option> <infile> <outfile> [outfile2] [psize] [pbyte]\n");
+	printf("You must use one of these options:\n");
+	printf(" /b - Split file into two files, alternating bytes into separate files.\n");
+	printf(" /c - Concatenate two files : <infile1> <infile2> <outfile>\n");
+	printf(" /d - Darksoft concatenate crom files : <infile1> <infile2> <outfile>\n");
+	printf(" /e - Darksoft concatenate prom files : <infile1> <infile2> <outpath>\n");
+	printf(" /f - Flip low/high bytes of a file. (<outfile> optional.) /f32 /f64 for wider values.\n");
+	printf(" /h - Split file in half (two files).\n");
+	printf(" /i - Generate rom information (size,crc) (as a text file). Add zip, md5, sha1 or all for more digests.\n");
+	printf(" /l - Split file by lanes : <ways> <lane> <infile> <outfile1> .. <outfileN>\n");
+	printf(" /m - Byte merge two files. (stores results in <outfile2>).\n");
+	printf(" /q - Byte merge four files. (See readme for syntax)\n");
+	printf(" /s - Swap top and bottom halves of a file. (<outfile2> optional.) /si swaps in place without a temporary.\n");
+	printf(" /u - Byte update two files. (stores results in <outfile2>). Optional [offset] after the size.\n");
+	printf(" /w - Split file into two files, alternating words into output files.\n");
+	printf(" /p - Pad file to [psize] in K with [pbyte] value (0-255).\n");
+	printf(" /z - Merge files by lanes : <ways> <lane> <infile1> .. <infileN> <outfile>\n");
+	printf(" /darksoft - Build a Darksoft/MiSTer set : <setdir> <outdir> [fpga]\n");
+	printf(" /batch - Run the commands listed in <manifest>, one per line, in parallel.\n");
+	printf(" /serve - Run operations for other programs, sent over the Unix socket <socket>.\n");
+	printf("\n");
+	printf("NOTE: Omission of [outfile2] will result in the second file not being saved.\n");
+	printf("\n");
+	printf("See the included README.md for more details. If README.md was not included,\n");
+	printf("please visit https://github.com/freem/romwak/\n");
+}
+/*----------------------------------------------------------------------------*/
+
+/* FileExists(char *fileIn) - Helper function to determine if a file exists.
+ *
+ * (Params)
+ * char *fileIn			Target filename
+ */
+bool FileExists(char *fileIn){
+	FILE *f;
+
+	if(MemFileName(fileIn)){
+		if(MemFileFind(fileIn) != NULL){
+			return true;
+		}
+		errno = ENOENT;
+		perror("Error attempting to open file");
+		return false;
+	}
+
+	/* try opening file */
+	f = fopen(fileIn,"r");
+	if(f != NULL){
+		/* file open was successful, we don't need this handle. */
+		fclose(f);
+		return true;
+	}
+	/* file open unsuccessful, print error */
+	perror("Error attempting to open file");
+	return false;
+}
+/*----------------------------------------------------------------------------*/
+
+/* FileSize(FILE *pFile) - Helper function to determine a file's size.
+ * Does not rewind the file, you must do it yourself.
+ *
+ * (Params)
+ * FILE *pFile			Handle to a loaded file.
+ */
+long FileSize(FILE *pFile){
+	fseek(pFile,0,SEEK_END); /* SEEK_END is non-portable, sorry */
+	return ftell(pFile);
+}
+/*----------------------------------------------------------------------------*/
+
+/* [Streaming Engine]
+ * Operations never load whole files. Inputs and outputs are attached to a
+ * StreamJob, then data flows through them in chunks of at most STREAM_CHUNK
+ * bytes per port, so peak memory does not depend on the ROM size.
+ */
+
+/* #define USE_PRINTF_ERRORS */
+
+/* [Asynchronous Writes]
+ * Where io_uring is available, writes from an output's own buffer are queued
+ * on a ring owned by the job instead of going through fwrite(). Each output
+ * rotates through STREAM_QUEUE buffers, so the next chunk is produced while
+ * earlier ones are still being written, and the writes of all outputs of a
+ * pass go to the kernel in one system call. Anything else an output does
+ * (stdio writes, seeks, kernel copies, closing) waits for its queue first,
+ * see StreamSettle(). Without io_uring, or with ROMWAK_NO_URING set in the
+ * environment, everything goes through stdio as before.
+ */
+#ifdef ROMWAK_URING
+#define URING_ENTRIES	32
+
+typedef struct {
+	int fd;
+	unsigned entries;
+	unsigned queued;		/* pushed, not submitted yet */
+	unsigned inFlight;		/* submitted or queued, not completed yet */
+	unsigned *sqHead, *sqTail, *sqMask, *sqArray;
+	unsigned *cqHead, *cqTail, *cqMask;
+	struct io_uring_sqe *sqes;
+	struct io_uring_cqe *cqes;
+	void *sqRing, *cqRing;
+	size_t sqSize, cqSize;
+	struct iovec iov[URING_ENTRIES];	/* one per submission slot */
+	struct {
+		const unsigned char *data;
+		size_t length;
+		__u64 offset;
+	} writes[STREAM_MAX_PORTS][STREAM_QUEUE];	/* what is left of each buffer's write */
+} IoRing;
+
+/* UringProbe() - Decide once, for every thread, whether jobs use io_uring:
+ * not with ROMWAK_NO_URING set, nor on kernels without it or too old for
+ * iovecs that only live until submission (Linux 5.5 and later). */
+static bool uringUsable = false;
+static pthread_once_t uringOnce = PTHREAD_ONCE_INIT;
+
+static void UringProbe(void){
+	struct io_uring_params params;
+	int fd;
+
+	if(getenv("ROMWAK_NO_URING") != NULL){
+		return;
+	}
+	memset(&params,0,sizeof(params));
+	fd = (int)syscall(__NR_io_uring_setup,1,&params);
+	if(fd >= 0){
+		uringUsable = (params.features & IORING_FEAT_SUBMIT_STABLE) != 0;
+		close(fd);
+	}
+}
+
+/* UringOpen() - Set up a ring, NULL when io_uring can't be used here. */
+static IoRing *UringOpen(void){
+	struct io_uring_params params;
+	IoRing *ring;
+	void *sqes;
+
+	pthread_once(&uringOnce,UringProbe);
+	if(!uringUsable){
+		return NULL;
+	}
+	ring = (IoRing*)calloc(1,sizeof(IoRing));
+	if(ring == NULL){
+		return NULL;
+	}
+	memset(&params,0,sizeof(params));
+	ring->fd = (int)syscall(__NR_io_uring_setup,URING_ENTRIES,&params);
+	if(ring->fd < 0){
+		free(ring);
+		return NULL;
+	}
+
+	ring->entries = params.sq_entries < URING_ENTRIES ? params.sq_entries : URING_ENTRIES;
+	ring->sqSize = params.sq_off.array+params.sq_entries*sizeof(unsigned);
+	ring->cqSize = params.cq_off.cqes+params.cq_entries*sizeof(struct io_uring_cqe);
+	if(params.features & IORING_FEAT_SINGLE_MMAP){
+		if(ring->cqSize > ring->sqSize){
+			ring->sqSize = ring->cqSize;
+		}
+		ring->cqSize = ring->sqSize;
+	}
+	ring->sqRing = mmap(NULL,ring->sqSize,PROT_READ|PROT_WRITE,MAP_SHARED|MAP_POPULATE,ring->fd,IORING_OFF_SQ_RING);
+	ring->cqRing = ring->sqRing;
+	if(ring->sqRing != MAP_FAILED && !(params.features & IORING_FEAT_SINGLE_MMAP)){
+		ring->cqRing = mmap(NULL,ring->cqSize,PROT_READ|PROT_WRITE,MAP_SHARED|MAP_POPULATE,ring->fd,IORING_OFF_CQ_RING);
+	}
+	sqes = mmap(NULL,params.sq_entries*sizeof(struct io_uring_sqe),PROT_READ|PROT_WRITE,MAP_SHARED|MAP_POPULATE,ring->fd,IORING_OFF_SQES);
+	if(ring->sqRing == MAP_FAILED || ring->cqRing == MAP_FAILED || sqes == MAP_FAILED){
+		if(sqes != MAP_FAILED){
+			munmap(sqes,params.sq_entries*sizeof(struct io_uring_sqe));
+		}
+		if(ring->cqRing != MAP_FAILED && ring->cqRing != ring->sqRing){
+			munmap(ring->cqRing,ring->cqSize);
+		}
+		if(ring->sqRing != MAP_FAILED){
+			munmap(ring->sqRing,ring->sqSize);
+		}
+		close(ring->fd);
+		free(ring);
+		return NULL;
+	}
+
+	ring->sqHead = (unsigned*)((char*)ring->sqRing+params.sq_off.head);
+	ring->sqTail = (unsigned*)((char*)ring->sqRing+params.sq_off.tail);
+	ring->sqMask = (unsigned*)((char*)ring->sqRing+params.sq_off.ring_mask);
+	ring->sqArray = (unsigned*)((char*)ring->sqRing+params.sq_off.array);
+	ring->cqHead = (unsigned*)((char*)ring->cqRing+params.cq_off.head);
+	ring->cqTail = (unsigned*)((char*)ring->cqRing+params.cq_off.tail);
+	ring->cqMask = (unsigned*)((char*)ring->cqRing+params.cq_off.ring_mask);
+	ring->cqes = (struct io_uring_cqe*)((char*)ring->cqRing+params.cq_off.cqes);
+	ring->sqes = (struct io_uring_sqe*)sqes;
+	return ring;
+}
+
+/* UringClose(IoRing *ring) - Release a ring with nothing left in flight. */
+static void UringClose(IoRing *ring){
+	munmap(ring->sqes,(*ring->sqMask+1)*sizeof(struct io_uring_sqe));
+	if(ring->cqRing != ring->sqRing){
+		munmap(ring->cqRing,ring->cqSize);
+	}
+	munmap(ring->sqRing,ring->sqSize);
+	close(ring->fd);
+	free(ring);
+}
+
+/* UringQueue(IoRing *ring, StreamOut *s, int port, int slot) - Push a write
+ * of what is left of an output buffer's write (ring->writes) to the ring.
+ * There is always room: nothing is pushed past ring->entries in flight. */
+static void UringQueue(IoRing *ring, StreamOut *s, int port, int slot){
+	struct io_uring_sqe *sqe;
+	unsigned tail, index;
+
+	tail = *ring->sqTail;
+	index = tail & *ring->sqMask;
+	ring->iov[index % URING_ENTRIES].iov_base = (void*)ring->writes[port][slot].data;
+	ring->iov[index % URING_ENTRIES].iov_len = ring->writes[port][slot].length;
+	sqe = &ring->sqes[index];
+	memset(sqe,0,sizeof(struct io_uring_sqe));
+	sqe->opcode = IORING_OP_WRITEV;
+	sqe->fd = fileno(s->file);
+	sqe->off = ring->writes[port][slot].offset;
+	sqe->addr = (unsigned long)&ring->iov[index % URING_ENTRIES];
+	sqe->len = 1;
+	sqe->user_data = (__u64)port << 8 | (__u64)slot;
+	ring->sqArray[index] = index;
+	__atomic_store_n(ring->sqTail,tail+1,__ATOMIC_RELEASE);
+	ring->queued++;
+}
+
+/* UringWait(StreamJob *job, unsigned wait) - Submit what is queued, wait for
+ * at least wait completions, and hand every completion back to its output.
+ * A short write is queued again for the rest, as write() would be retried;
+ * only one that writes nothing means the disk is full. Returns 0 on success. */
+static int UringWait(StreamJob *job, unsigned wait){
+	IoRing *ring = (IoRing*)job->ring;
+	struct io_uring_cqe *cqe;
+	StreamOut *out;
+	unsigned head, tail;
+	int port, slot;
+	long done;
+
+	do{
+		done = syscall(__NR_io_uring_enter,ring->fd,ring->queued,wait,wait ? IORING_ENTER_GETEVENTS : 0U,NULL,0);
+	}while(done < 0 && errno == EINTR);
+	if(done < 0){
+		JobError(job,"writing","output files");
+		return -1;
+	}
+	ring->queued -= (unsigned)done;
+
+	head = *ring->cqHead;
+	tail = __atomic_load_n(ring->cqTail,__ATOMIC_ACQUIRE);
+	for(;head != tail;head++){
+		/* user_data: output << 8 | buffer */
+		cqe = &ring->cqes[head & *ring->cqMask];
+		port = (int)(cqe->user_data >> 8) & 0xFF;
+		slot = (int)cqe->user_data & 0xFF;
+		out = &job->out[port];
+		if(cqe->res > 0 && (size_t)cqe->res < ring->writes[port][slot].length && out->ioError == 0){
+			/* still in flight, from where the kernel stopped */
+			ring->writes[port][slot].data += cqe->res;
+			ring->writes[port][slot].length -= (size_t)cqe->res;
+			ring->writes[port][slot].offset += (__u64)cqe->res;
+			UringQueue(ring,out,port,slot);
+			continue;
+		}
+		out->busy[slot]--;
+		out->pending--;
+		ring->inFlight--;
+		if(cqe->res < 0 && out->ioError == 0){
+			out->ioError = -cqe->res;
+		}
+		else if(cqe->res == 0 && out->ioError == 0){
+			out->ioError = ENOSPC; /* nothing written: the disk filled up */
+		}
+	}
+	__atomic_store_n(ring->cqHead,head,__ATOMIC_RELEASE);
+	return 0;
+}
+
+/* UringWrite(StreamJob *job, StreamOut *s, size_t n) - Queue a write of the
+ * output's current buffer at its current position. Returns 0 on success. */
+static int UringWrite(StreamJob *job, StreamOut *s, size_t n){
+	IoRing *ring = (IoRing*)job->ring;
+	int port = (int)(s-job->out);
+
+	if(!s->direct){
+		/* stdio is bypassed from here on */
+		if(fflush(s->file) != 0){
+			JobError(job,"writing",s->what);
+			return -1;
+		}
+		s->direct = true;
+	}
+	while(ring->inFlight >= ring->entries){
+		if(UringWait(job,1) != 0){
+			return -1;
+		}
+	}
+
+	ring->writes[port][s->slot].data = s->buf;
+	ring->writes[port][s->slot].length = n;
+	ring->writes[port][s->slot].offset = (__u64)s->pos;
+	UringQueue(ring,s,port,s->slot);
+
+	ring->inFlight++;
+	s->busy[s->slot]++;
+	s->pending++;
+	return 0;
+}
+#endif
+
+/* StreamSubmit(StreamJob *job) - Start the writes queued so far, without
+ * waiting for them. Returns 0 on success.
+ *
+ * (Params)
+ * StreamJob *job		Job whose writes are started
+ */
+int StreamSubmit(StreamJob *job){
+#ifdef ROMWAK_URING
+	if(job->ring != NULL && ((IoRing*)job->ring)->queued > 0){
+		return UringWait(job,0);
+	}
+#else
+	(void)job;
+#endif
+	return 0;
+}
+/*----------------------------------------------------------------------------*/
+
+/* StreamSettle(StreamJob *job, StreamOut *s) - Wait until the queued writes
+ * of an output are done and put its stdio position back where they ended,
+ * so the output can be used directly again. Returns 0 on success.
+ *
+ * (Params)
+ * StreamJob *job		Job the output belongs to
+ * StreamOut *s			Output to settle
+ */
+int StreamSettle(StreamJob *job, StreamOut *s){
+#ifdef ROMWAK_URING
+	while(s->pending > 0){
+		if(UringWait(job,1) != 0){
+			return -1;
+		}
+	}
+	if(s->ioError != 0){
+		errno = s->ioError;
+		JobError(job,"writing",s->what);
+		return -1;
+	}
+	if(s->direct){
+		s->direct = false;
+		if(fseek(s->file,s->pos,SEEK_SET) != 0){
+			JobError(job,"writing",s->what);
+			return -1;
+		}
+	}
+#else
+	(void)job; (void)s;
+#endif
+	return 0;
+}
+/*----------------------------------------------------------------------------*/
+
+/* JobInit(StreamJob *job) - Prepare an empty job.
+ *
+ * (Params)
+ * StreamJob *job		Job to initialize
+ */
+void JobInit(StreamJob *job){
+	memset(job,0,sizeof(StreamJob));
+}
+/*----------------------------------------------------------------------------*/
+
+/* JobError(StreamJob *job, const char *action, const char *what)
+ * Remember which step failed, for reporting with perror() later, and
+ * whether it was reading, writing or memory that ran out. Called right
+ * after the failing call, while errno still belongs to it.
+ *
+ * (Params)
+ * StreamJob *job		Job that failed
+ * const char *action	What was being done ("reading", "writing", ...)
+ * const char *what		Which port it was done to ("first input file", ...)
+ */
+void JobError(StreamJob *job, const char *action, const char *what){
+	sprintf(job->error,"Error %s %s",action,what);
+	if(errno == ENOMEM || strncmp(action,"allocating",10) == 0){
+		job->errorClass = JOB_ERROR_MEMORY;
+	}
+	else if(strcmp(action,"reading") == 0 || strcmp(action,"attempting to open") == 0 || strcmp(action,"empty") == 0){
+		job->errorClass = JOB_ERROR_READ;
+	}
+	else{
+		job->errorClass = JOB_ERROR_WRITE;
+	}
+}
+/*----------------------------------------------------------------------------*/
+
+/* FileDup(int fd, const char *mode) - A stream of its own on an open file,
+ * so closing it leaves fd open. Returns NULL on failure.
+ */
+static FILE *FileDup(int fd, const char *mode){
+	FILE *pFile = NULL;
+	int copy;
+
+#if defined(ROMWAK_POSIX)
+	copy = dup(fd);
+	if(copy >= 0 && (pFile = fdopen(copy,mode)) == NULL){
+		close(copy);
+	}
+#elif defined(_WIN32)
+	copy = _dup(fd);
+	if(copy >= 0 && (pFile = _fdopen(copy,mode)) == NULL){
+		_close(copy);
+	}
+#else
+	(void)fd; (void)mode; (void)copy;
+	errno = EINVAL;
+#endif
+	return pFile;
+}
+/*----------------------------------------------------------------------------*/
+
+/* JobInputFile(StreamJob *job, StreamIn *s) - Attach the next input once its
+ * file is open. Returns s, or NULL on failure.
+ */
+static StreamIn *JobInputFile(StreamJob *job, StreamIn *s){
+	job->numIn++;
+
+	/* find file size */
+	s->length = FileSize(s->file);
+	rewind(s->file);
+	if(s->length < 0){
+		JobError(job,"reading",s->what);
+		return NULL;
+	}
+
+	/* read straight from the page cache when possible */
+	if(!job->noMap){
+		MapInput(s);
+	}
+
+	/* several inputs load side by side */
+	if(job->numIn > 1){
+		JobPrefetch(job);
+	}
+	return s;
+}
+/*----------------------------------------------------------------------------*/
+
+/* JobInput(StreamJob *job, char *fileIn, const char *what)
+ * Open an input file and attach it to the job. Returns NULL on failure.
+ *
+ * (Params)
+ * StreamJob *job		Job to attach the input to
+ * char *fileIn			Input filename
+ * const char *what		Description used in error messages
+ */
+StreamIn *JobInput(StreamJob *job, char *fileIn, const char *what){
+	StreamIn *s = &job->in[job->numIn];
+
+	memset(s,0,sizeof(StreamIn));
+	s->path = fileIn;
+	s->what = what;
+	if(MemFileName(fileIn)){
+		s->mem = MemFileFind(fileIn);
+		if(s->mem == NULL){
+			errno = ENOENT;
+			JobError(job,"attempting to open",what);
+			return NULL;
+		}
+		/* reads come straight out of the buffer, like a mapping */
+		s->length = s->mem->length;
+		s->map = s->mem->data != NULL ? s->mem->data : (const unsigned char*)"";
+		job->numIn++;
+		return s;
+	}
+	s->file = fopen(fileIn,"rb");
+	if(s->file == NULL){
+		JobError(job,"attempting to open",what);
+		return NULL;
+	}
+	return JobInputFile(job,s);
+}
+/*----------------------------------------------------------------------------*/
+
+/* JobInputFd(StreamJob *job, int fd, const char *what)
+ * JobInputBuffer(StreamJob *job, const unsigned char *data, long length, const char *what)
+ * Attach an input that is an open file, read from its start, or a buffer
+ * owned by the caller. Returns NULL on failure.
+ *
+ * (Params)
+ * StreamJob *job		Job to attach the input to
+ * int fd				File descriptor; the job reads through a duplicate
+ * const unsigned char *data	Buffer holding length bytes
+ * const char *what		Description used in error messages
+ */
+StreamIn *JobInputFd(StreamJob *job, int fd, const char *what){
+	StreamIn *s = &job->in[job->numIn];
+
+	memset(s,0,sizeof(StreamIn));
+	s->path = (char*)"";
+	s->what = what;
+	s->file = FileDup(fd,"rb");
+	if(s->file == NULL){
+		JobError(job,"attempting to open",what);
+		return NULL;
+	}
+	return JobInputFile(job,s);
+}
+
+StreamIn *JobInputBuffer(StreamJob *job, const unsigned char *data, long length, const char *what){
+	StreamIn *s = &job->in[job->numIn];
+
+	memset(s,0,sizeof(StreamIn));
+	s->path = (char*)"";
+	s->what = what;
+	s->length = length;
+	s->map = data != NULL ? data : (const unsigned char*)"";
+	job->numIn++;
+	return s;
+}
+/*----------------------------------------------------------------------------*/
+
+/* [Chunk Cache]
+ * A long running process (/serve) keeps up to ChunkKeep() released chunks
+ * for the next job instead of going back to the allocator for every port
+ * of every request. Off by default, so commands free their chunks as before.
+ */
+#ifdef ROMWAK_POSIX
+static unsigned char *chunkCache[CHUNK_CACHE_MAX];
+static int chunkCached = 0, chunkKeep = 0;
+static pthread_mutex_t chunkLock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+/* ChunkAlloc() - A STREAM_CHUNK sized buffer, starting on a cache line so
+ * kernel threads splitting it at KERNEL_ALIGN boundaries never share one.
+ * Release with ChunkFree(). */
+static unsigned char *ChunkAlloc(void){
+#ifdef ROMWAK_POSIX
+	void *buf = NULL;
+
+	pthread_mutex_lock(&chunkLock);
+	if(chunkCached > 0){
+		buf = chunkCache[--chunkCached];
+	}
+	pthread_mutex_unlock(&chunkLock);
+	if(buf != NULL){
+		return (unsigned char*)buf;
+	}
+	return posix_memalign(&buf,KERNEL_ALIGN,STREAM_CHUNK) == 0 ? (unsigned char*)buf : NULL;
+#else
+	return (unsigned char*)malloc(STREAM_CHUNK);
+#endif
+}
+
+/* ChunkFree(unsigned char *buf) - Release a ChunkAlloc() buffer (or NULL). */
+static void ChunkFree(unsigned char *buf){
+#ifdef ROMWAK_POSIX
+	if(buf != NULL){
+		pthread_mutex_lock(&chunkLock);
+		if(chunkCached < chunkKeep){
+			chunkCache[chunkCached++] = buf;
+			buf = NULL;
+		}
+		pthread_mutex_unlock(&chunkLock);
+	}
+#endif
+	free(buf);
+}
+
+/* ChunkKeep(int chunks) - Keep up to chunks released chunks for reuse
+ * (at most CHUNK_CACHE_MAX); 0 frees the ones kept. */
+void ChunkKeep(int chunks){
+#ifdef ROMWAK_POSIX
+	pthread_mutex_lock(&chunkLock);
+	chunkKeep = chunks < 0 ? 0 : chunks < CHUNK_CACHE_MAX ? chunks : CHUNK_CACHE_MAX;
+	while(chunkCached > chunkKeep){
+		free(chunkCache[--chunkCached]);
+	}
+	pthread_mutex_unlock(&chunkLock);
+#else
+	(void)chunks;
+#endif
+}
+/*----------------------------------------------------------------------------*/
+
+/* MapInput(StreamIn *s) - Map an input into memory for zero-copy reads.
+ * Inputs that cannot be mapped (empty files, no mmap on this platform,
+ * address space exhausted) silently keep using fread().
+ *
+ * (Params)
+ * StreamIn *s			Input to map
+ */
+void MapInput(StreamIn *s){
+#ifdef ROMWAK_POSIX
+	void *map;
+
+	if(s->length <= 0){
+		return;
+	}
+	map = mmap(NULL,(size_t)s->length,PROT_READ,MAP_PRIVATE,fileno(s->file),0);
+	if(map == MAP_FAILED){
+		return;
+	}
+	posix_madvise(map,(size_t)s->length,POSIX_MADV_SEQUENTIAL);
+	posix_madvise(map,(size_t)s->length,POSIX_MADV_WILLNEED);
+	s->map = (const unsigned char*)map;
+#else
+	(void)s;
+#endif
+}
+/*----------------------------------------------------------------------------*/
+
+/* UnmapInput(StreamIn *s) - Release the mapping made by MapInput().
+ *
+ * (Params)
+ * StreamIn *s			Input to unmap
+ */
+void UnmapInput(StreamIn *s){
+#ifdef ROMWAK_POSIX
+	/* memory files and buffers aren't mappings */
+	if(s->map != NULL && s->file != NULL){
+		munmap((void*)s->map,(size_t)s->length);
+	}
+#endif
+	s->map = NULL;
+}
+/*----------------------------------------------------------------------------*/
+
+/* JobPrefetch(StreamJob *job) - Load the file inputs of a job concurrently.
+ * Every input gets a thread that pulls it into the page cache ahead of the
+ * operation, so an operation reading several files waits about as long as
+ * the slowest one rather than the sum of all of them. Inputs too large to
+ * keep cached (PREFETCH_MAX bytes altogether) are left to readahead.
+ *
+ * (Params)
+ * StreamJob *job		Job whose inputs are loaded
+ */
+#ifdef ROMWAK_POSIX
+typedef struct {
+	StreamIn *s;
+	pthread_t tid;
+	pthread_mutex_t lock;
+	bool stop;				/* set when the job is done with the input */
+} InputPrefetch;
+
+static void *PrefetchWorker(void *arg){
+	InputPrefetch *p = (InputPrefetch*)arg;
+	StreamIn *s = p->s;
+	unsigned char *buf = NULL;
+	volatile unsigned char sink = 0;
+	bool stop = false;
+	long pos, n, i;
+
+	if(s->map == NULL && (buf = (unsigned char*)malloc(STREAM_CHUNK)) == NULL){
+		return NULL;
+	}
+	for(pos=0;pos<s->length && !stop;pos+=n){
+		n = s->length-pos < STREAM_CHUNK ? s->length-pos : STREAM_CHUNK;
+		if(s->map != NULL){
+			/* faulting a page in reads it, and maps it for the job too */
+			for(i=0;i<n;i+=PREFETCH_PAGE){
+				sink ^= s->map[pos+i];
+			}
+		}
+		else if(pread(fileno(s->file),buf,(size_t)n,(off_t)pos) <= 0){
+			break;
+		}
+		pthread_mutex_lock(&p->lock);
+		stop = p->stop;
+		pthread_mutex_unlock(&p->lock);
+	}
+	free(buf);
+	(void)sink;
+	return NULL;
+}
+#endif
+
+void JobPrefetch(StreamJob *job){
+#ifdef ROMWAK_POSIX
+	InputPrefetch *p;
+	long total = 0;
+	int i;
+
+	for(i=0;i<job->numIn;i++){
+		if(job->in[i].file != NULL){
+			total += job->in[i].length;
+		}
+	}
+	if(total > PREFETCH_MAX){
+		return;
+	}
+	for(i=0;i<job->numIn;i++){
+		if(job->in[i].file == NULL || job->in[i].prefetch != NULL || job->in[i].length <= 0){
+			continue;
+		}
+		p = (InputPrefetch*)calloc(1,sizeof(InputPrefetch));
+		if(p == NULL){
+			return;
+		}
+		p->s = &job->in[i];
+		pthread_mutex_init(&p->lock,NULL);
+		if(pthread_create(&p->tid,NULL,PrefetchWorker,p) != 0){
+			/* the job still works, only without the head start */
+			pthread_mutex_destroy(&p->lock);
+			free(p);
+			return;
+		}
+		job->in[i].prefetch = p;
+	}
+#else
+	(void)job;
+#endif
+}
+/*----------------------------------------------------------------------------*/
+
+/* PrefetchStop(StreamIn *s) - Stop the thread started by JobPrefetch(), and
+ * wait for it before the input goes away.
+ *
+ * (Params)
+ * StreamIn *s			Input being closed
+ */
+void PrefetchStop(StreamIn *s){
+#ifdef ROMWAK_POSIX
+	InputPrefetch *p = (InputPrefetch*)s->prefetch;
+
+	if(p == NULL){
+		return;
+	}
+	pthread_mutex_lock(&p->lock);
+	p->stop = true;
+	pthread_mutex_unlock(&p->lock);
+	pthread_join(p->tid,NULL);
+	pthread_mutex_destroy(&p->lock);
+	free(p);
+#endif
+	s->prefetch = NULL;
+}
+/*----------------------------------------------------------------------------*/
+
+/* JobOutput(StreamJob *job, char *fileOut, const char *what)
+ * Create an output file and attach it to the job. Returns NULL on failure.
+ *
+ * If the output is also one of the job's inputs, the data goes to a
+ * temporary file that replaces the original once the job succeeded. The
+ * original file is left untouched if anything fails on the way.
+ *
+ * (Params)
+ * StreamJob *job		Job to attach the output to
+ * char *fileOut		Output filename
+ * const char *what		Description used in error messages
+ */
+StreamOut *JobOutput(StreamJob *job, char *fileOut, const char *what){
+	StreamOut *s = &job->out[job->numOut];
+	int i;
+
+	memset(s,0,sizeof(StreamOut));
+	s->path = fileOut;
+	s->what = what;
+	if(MemFileName(fileOut)){
+		/* built on the side and swapped in by JobClose(), so replacing an
+		 * input needs no temporary */
+		s->mem = (MemFile*)calloc(1,sizeof(MemFile));
+		if(s->mem == NULL || (s->mem->name = (char*)malloc(strlen(fileOut)+1)) == NULL){
+			JobError(job,"allocating memory for",what);
+			free(s->mem);
+			return NULL;
+		}
+		strcpy(s->mem->name,fileOut);
+		job->numOut++;
+		return s;
+	}
+	for(i=0;i<job->numIn;i++){
+		if(strcmp(job->in[i].path,fileOut) == 0){
+			s->tempPath = (char*)malloc(strlen(fileOut)+5);
+			if(s->tempPath == NULL){
+				JobError(job,"allocating memory for",what);
+				return NULL;
+			}
+			sprintf(s->tempPath,"%s.tmp",fileOut);
+			break;
+		}
+	}
+
+	s->file = fopen(s->tempPath != NULL ? s->tempPath : fileOut,"wb");
+	if(s->file == NULL){
+		JobError(job,"attempting to create",what);
+		free(s->tempPath);
+		return NULL;
+	}
+	job->numOut++;
+	return s;
+}
+/*----------------------------------------------------------------------------*/
+
+/* JobOutputFd(StreamJob *job, int fd, const char *what)
+ * JobOutputBuffer(StreamJob *job, unsigned char *data, long size, const char *what)
+ * Attach an output that is an open file, written from its start, or a
+ * buffer with room for size bytes owned by the caller; writing past its end
+ * fails with ENOSPC. A file is not truncated here: JobOutputTruncate() does
+ * that once every output is attached. Returns NULL on failure.
+ *
+ * (Params)
+ * StreamJob *job		Job to attach the output to
+ * int fd				File descriptor; the job writes through a duplicate
+ * unsigned char *data	Buffer receiving the output
+ * long size			Size of the buffer
+ * const char *what		Description used in error messages
+ */
+StreamOut *JobOutputFd(StreamJob *job, int fd, const char *what){
+	StreamOut *s = &job->out[job->numOut];
+
+	memset(s,0,sizeof(StreamOut));
+	s->path = (char*)"";
+	s->what = what;
+	s->file = FileDup(fd,"wb");
+	if(s->file == NULL){
+		JobError(job,"attempting to create",what);
+		return NULL;
+	}
+	job->numOut++;
+	if(fseek(s->file,0,SEEK_SET) != 0){
+		JobError(job,"attempting to create",what);
+		return NULL;
+	}
+	return s;
+}
+
+StreamOut *JobOutputBuffer(StreamJob *job, unsigned char *data, long size, const char *what){
+	StreamOut *s = &job->out[job->numOut];
+
+	memset(s,0,sizeof(StreamOut));
+	s->path = (char*)"";
+	s->what = what;
+	s->mem = (MemFile*)calloc(1,sizeof(MemFile));
+	if(s->mem == NULL){
+		JobError(job,"allocating memory for",what);
+		return NULL;
+	}
+	s->mem->data = data;
+	s->mem->size = size;
+	s->mem->fixed = true;
+	job->numOut++;
+	return s;
+}
+
+/* JobOutputTruncate(StreamJob *job, StreamOut *s)
+ * Empty a file output attached with JobOutputFd(), so nothing the caller
+ * hands in is touched until all of it has been accepted.
+ * Returns EXIT_SUCCESS or EXIT_FAILURE. */
+int JobOutputTruncate(StreamJob *job, StreamOut *s){
+#if defined(ROMWAK_POSIX)
+	if(ftruncate(fileno(s->file),0) != 0){
+#elif defined(_WIN32)
+	if(_chsize(_fileno(s->file),0) != 0){
+#else
+	if(0){
+#endif
+		JobError(job,"attempting to create",s->what);
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
+/*----------------------------------------------------------------------------*/
+
+/* JobClose(StreamJob *job) - Close every port of a job.
+ * Temporary outputs are renamed over their targets, unless the job failed.
+ * Returns 0 on success.
+ *
+ * (Params)
+ * StreamJob *job		Job to close
+ */
+int JobClose(StreamJob *job){
+	int status = 0;
+	int i, j;
+	StreamOut *out;
+
+	for(i=0;i<job->numOut;i++){
+		out = &job->out[i];
+		if(StreamSettle(job,out) != 0 && !job->failed){
+			job->failed = true;
+		}
+		if(out->file != NULL && fclose(out->file) != 0 && !job->failed){
+			JobError(job,"writing",out->what);
+			job->failed = true;
+		}
+		for(j=0;j<STREAM_QUEUE;j++){
+			ChunkFree(out->queue[j]);
+		}
+	}
+#ifdef ROMWAK_URING
+	if(job->ring != NULL){
+		UringClose((IoRing*)job->ring);
+		job->ring = NULL;
+	}
+#endif
+	JobCloseInputs(job);
+
+	/* publish in-memory outputs, now that no input points into the
+	 * buffers they replace */
+	for(i=0;i<job->numOut;i++){
+		out = &job->out[i];
+		if(out->mem != NULL && out->mem->fixed){
+			free(out->mem);	/* the data is the caller's */
+		}
+		else if(out->mem != NULL){
+			MemFilePublish(out->mem,!job->failed);
+		}
+	}
+
+	/* move temporary outputs into place */
+	for(i=0;i<job->numOut;i++){
+		out = &job->out[i];
+		if(out->tempPath == NULL){
+			continue;
+		}
+		if(!job->failed && rename(out->tempPath,out->path) != 0){
+			/* rename() over an existing file isn't allowed everywhere */
+			if(remove(out->path) != 0 || rename(out->tempPath,out->path) != 0){
+				JobError(job,"attempting to create",out->what);
+				job->failed = true;
+			}
+		}
+		if(job->failed){
+			remove(out->tempPath);
+		}
+		free(out->tempPath);
+	}
+
+	if(job->failed){
+		status = -1;
+	}
+	job->numIn = 0;
+	job->numOut = 0;
+	return status;
+}
+/*----------------------------------------------------------------------------*/
+
+/* JobCloseInputs(StreamJob *job) - Close the inputs of a job but keep its
+ * outputs, so further inputs can be streamed into the same outputs.
+ *
+ * (Params)
+ * StreamJob *job		Job whose inputs are closed
+ */
+void JobCloseInputs(StreamJob *job){
+	int i;
+
+	for(i=0;i<job->numIn;i++){
+		PrefetchStop(&job->in[i]);
+		UnmapInput(&job->in[i]);
+		if(job->in[i].file != NULL){
+			fclose(job->in[i].file);
+		}
+		ChunkFree(job->in[i].buf);
+	}
+	job->numIn = 0;
+}
+/*----------------------------------------------------------------------------*/
+
+/* JobFail(StreamJob *job) - Report the failed step and close the job.
+ * Returns EXIT_FAILURE so operations can simply return its result.
+ *
+ * (Params)
+ * StreamJob *job		Job that failed
+ */
+int JobFail(StreamJob *job){
+	#ifdef USE_PRINTF_ERRORS
+	printf("%s\n",job->error);
+	#endif
+	perror(job->error);
+	job->failed = true;
+	JobClose(job);
+	return EXIT_FAILURE;
+}
+/*----------------------------------------------------------------------------*/
+
+/* StreamRead(StreamJob *job, StreamIn *s, size_t n, const unsigned char **data)
+ * Read the next n bytes (at most STREAM_CHUNK) of an input. Running into the
+ * end of the file is an error. Mapped inputs hand out a pointer into the
+ * mapping instead of copying. Returns 0 on success.
+ *
+ * (Params)
+ * StreamJob *job		Job the input belongs to
+ * StreamIn *s			Input to read from
+ * size_t n				Number of bytes to read
+ * const unsigned char **data	Receives a pointer to the data
+ */
+int StreamRead(StreamJob *job, StreamIn *s, size_t n, const unsigned char **data){
+	if(s->map != NULL){
+		if((long)n > s->length-s->pos){
+			errno = EIO; /* file is shorter than expected */
+			JobError(job,"reading",s->what);
+			return -1;
+		}
+		*data = s->map+s->pos;
+		s->pos += n;
+		return 0;
+	}
+
+	if(s->buf == NULL){
+		s->buf = ChunkAlloc();
+		if(s->buf == NULL){
+			JobError(job,"allocating memory for",s->what);
+			return -1;
+		}
+	}
+
+	if(fread(s->buf,sizeof(unsigned char),n,s->file) != n){
+		if(!ferror(s->file)){
+			errno = EIO; /* file is shorter than expected */
+		}
+		JobError(job,"reading",s->what);
+		return -1;
+	}
+	s->pos += n;
+	*data = s->buf;
+	return 0;
+}
+/*----------------------------------------------------------------------------*/
+
+/* StreamSeek(StreamJob *job, StreamIn *s, long offset)
+ * Move the read position of an input. Returns 0 on success.
+ *
+ * (Params)
+ * StreamJob *job		Job the input belongs to
+ * StreamIn *s			Input to reposition
+ * long offset			New position from the start of the file
+ */
+int StreamSeek(StreamJob *job, StreamIn *s, long offset){
+	if(s->map == NULL && fseek(s->file,offset,SEEK_SET) != 0){
+		JobError(job,"reading",s->what);
+		return -1;
+	}
+	s->pos = offset;
+	return 0;
+}
+/*----------------------------------------------------------------------------*/
+
+/* StreamBuffer(StreamJob *job, StreamOut *s)
+ * Get the STREAM_CHUNK sized work buffer of an output. While the current one
+ * is still being written asynchronously, the next buffer of the output's
+ * queue is handed out instead. Returns NULL on failure.
+ *
+ * (Params)
+ * StreamJob *job		Job the output belongs to
+ * StreamOut *s			Output owning the buffer
+ */
+unsigned char *StreamBuffer(StreamJob *job, StreamOut *s){
+#ifdef ROMWAK_URING
+	if(s->buf != NULL && s->busy[s->slot] > 0){
+		s->slot = (s->slot+1) % STREAM_QUEUE;
+		while(s->busy[s->slot] > 0){
+			if(UringWait(job,1) != 0){
+				return NULL;
+			}
+		}
+		s->buf = s->queue[s->slot];
+	}
+#endif
+	if(s->buf == NULL){
+		s->buf = ChunkAlloc();
+		if(s->buf == NULL){
+			JobError(job,"allocating memory for",s->what);
+		}
+		s->queue[s->slot] = s->buf;
+	}
+	return s->buf;
+}
+/*----------------------------------------------------------------------------*/
+
+/* StreamWrite(StreamJob *job, StreamOut *s, const unsigned char *data, size_t n)
+ * Append n bytes to an output. Data in the output's buffer (StreamBuffer) may
+ * be written asynchronously; get a fresh buffer before filling it again.
+ * Returns 0 on success.
+ *
+ * (Params)
+ * StreamJob *job		Job the output belongs to
+ * StreamOut *s			Output to write to
+ * const unsigned char *data	Data to write
+ * size_t n				Number of bytes to write
+ */
+int StreamWrite(StreamJob *job, StreamOut *s, const unsigned char *data, size_t n){
+	MemFile *mem = s->mem;
+	unsigned char *grown;
+	long size;
+
+	if(mem != NULL){
+		if(mem->length+(long)n > mem->size && mem->fixed){
+			errno = ENOSPC; /* the caller's buffer is full */
+			JobError(job,"writing",s->what);
+			return -1;
+		}
+		if(mem->length+(long)n > mem->size){
+			for(size = mem->size ? mem->size : STREAM_CHUNK; size < mem->length+(long)n; size *= 2)
+				;
+			grown = (unsigned char*)realloc(mem->data,(size_t)size);
+			if(grown == NULL){
+				JobError(job,"allocating memory for",s->what);
+				return -1;
+			}
+			mem->data = grown;
+			mem->size = size;
+		}
+		memcpy(mem->data+mem->length,data,n);
+		mem->length += (long)n;
+		s->pos += n;
+		return 0;
+	}
+#ifdef ROMWAK_URING
+	/* the output's own buffer stays put until written; queue it */
+	if(data == s->buf && n > 0 && s->ioError == 0
+	&& (job->ring != NULL || (job->ring = UringOpen()) != NULL)){
+		if(UringWrite(job,s,n) != 0){
+			return -1;
+		}
+		s->pos += n;
+		return 0;
+	}
+#endif
+	if(StreamSettle(job,s) != 0){
+		return -1;
+	}
+	if(fwrite(data,sizeof(unsigned char),n,s->file) != n){
+		JobError(job,"writing",s->what);
+		return -1;
+	}
+	s->pos += n;
+	return 0;
+}
+/*----------------------------------------------------------------------------*/
+
+/* KernelCopy(StreamJob *job, StreamIn *in, StreamOut *out, long length)
+ * Let the kernel copy up to length bytes between two files without them
+ * passing through user space: a reflink (FICLONERANGE) where the filesystem
+ * shares extents (btrfs, XFS), else copy_file_range(). Both ports advance
+ * past what was copied. Returns the number of bytes copied; anything left
+ * over is for the caller to copy, 0 when neither works here. Returns -1
+ * when the streams can't be moved past the copy.
+ *
+ * (Params)
+ * StreamJob *job		Job both ports belong to
+ * StreamIn *in			Input to copy from
+ * StreamOut *out		Output to copy to
+ * long length			Number of bytes to copy
+ */
+long KernelCopy(StreamJob *job, StreamIn *in, StreamOut *out, long length){
+	long copied = 0;
+#ifdef ROMWAK_LINUX
+#ifdef __NR_copy_file_range
+	loff_t inPos = in->pos, outPos = out->pos;
+	ssize_t n;
+#endif
+#ifdef FICLONERANGE
+	struct file_clone_range range;
+#endif
+
+	/* small copies aren't worth the system calls */
+	if(length < KERNEL_COPY_MIN || in->file == NULL || out->file == NULL){
+		return 0;
+	}
+	if(fflush(out->file) != 0){
+		return 0;
+	}
+
+#ifdef FICLONERANGE
+	/* needs block aligned offsets, and a length that is aligned or ends the input */
+	range.src_fd = fileno(in->file);
+	range.src_offset = in->pos;
+	range.src_length = length;
+	range.dest_offset = out->pos;
+	if(ioctl(fileno(out->file),FICLONERANGE,&range) == 0){
+		copied = length;
+	}
+#endif
+#ifdef __NR_copy_file_range
+	while(copied < length){
+		n = syscall(__NR_copy_file_range,fileno(in->file),&inPos,fileno(out->file),&outPos,(size_t)(length-copied),0U);
+		if(n <= 0){
+			break;	/* not supported between these files; fall back */
+		}
+		copied += (long)n;
+	}
+#endif
+	if(copied == 0){
+		return 0;
+	}
+
+	/* both system calls work on explicit offsets; bring the streams along */
+	in->pos += copied;
+	out->pos += copied;
+	if(in->map == NULL && fseek(in->file,in->pos,SEEK_SET) != 0){
+		JobError(job,"reading",in->what);
+		return -1;
+	}
+	if(fseek(out->file,out->pos,SEEK_SET) != 0){
+		JobError(job,"writing",out->what);
+		return -1;
+	}
+#else
+	(void)job; (void)in; (void)out; (void)length;
+#endif
+	return copied;
+}
+/*----------------------------------------------------------------------------*/
+
+/* StreamCopy(StreamJob *job, StreamIn *in, StreamOut *out, long length)
+ * Copy length bytes from the current position of an input to an output.
+ * Large copies between real files are left to the kernel (KernelCopy).
+ * Returns 0 on success.
+ *
+ * (Params)
+ * StreamJob *job		Job both ports belong to
+ * StreamIn *in			Input to copy from
+ * StreamOut *out		Output to copy to
+ * long length			Number of bytes to copy
+ */
+int StreamCopy(StreamJob *job, StreamIn *in, StreamOut *out, long length){
+	const unsigned char *data;
+	long copied;
+	size_t n;
+
+	if(StreamSettle(job,out) != 0){
+		return -1;
+	}
+	copied = KernelCopy(job,in,out,length);
+	if(copied < 0){
+		return -1;
+	}
+	length -= copied;
+	while(length > 0){
+		n = length < STREAM_CHUNK ? (size_t)length : STREAM_CHUNK;
+		if(StreamRead(job,in,n,&data) != 0 || StreamWrite(job,out,data,n) != 0){
+			return -1;
+		}
+		length -= n;
+	}
+	return 0;
+}
+/*----------------------------------------------------------------------------*/
+
+/* StreamPatch(StreamJob *job, StreamIn *in, StreamOut *out, long offset, long length)
+ * Overwrite length bytes already written to an output, starting at offset,
+ * with the next length bytes of an input. Writing then carries on at the
+ * end of the output as before. Returns 0 on success.
+ *
+ * (Params)
+ * StreamJob *job		Job both ports belong to
+ * StreamIn *in			Input to copy from
+ * StreamOut *out		Output to patch
+ * long offset			Where in the output the patch goes
+ * long length			Number of bytes to patch
+ */
+int StreamPatch(StreamJob *job, StreamIn *in, StreamOut *out, long offset, long length){
+	const unsigned char *data;
+	size_t n;
+
+	if(offset < 0 || length < 0 || offset+length > out->pos){
+		errno = EINVAL; /* patch beyond what was written */
+		JobError(job,"writing",out->what);
+		return -1;
+	}
+	if(out->mem == NULL && (StreamSettle(job,out) != 0 || fflush(out->file) != 0 || fseek(out->file,offset,SEEK_SET) != 0)){
+		JobError(job,"writing",out->what);
+		return -1;
+	}
+
+	while(length > 0){
+		n = length < STREAM_CHUNK ? (size_t)length : STREAM_CHUNK;
+		if(StreamRead(job,in,n,&data) != 0){
+			return -1;
+		}
+		if(out->mem != NULL){
+			memcpy(out->mem->data+offset,data,n);
+		}
+		else if(fwrite(data,sizeof(unsigned char),n,out->file) != n){
+			JobError(job,"writing",out->what);
+			return -1;
+		}
+		offset += (long)n;
+		length -= (long)n;
+	}
+
+	if(out->mem == NULL && fseek(out->file,out->pos,SEEK_SET) != 0){
+		JobError(job,"writing",out->what);
+		return -1;
+	}
+	return 0;
+}
+/*----------------------------------------------------------------------------*/
+
+/* StreamFill(StreamJob *job, StreamOut *out, unsigned char value, long length)
+ * Append length copies of value to an output. Long runs of zeros going to a
+ * file are left as a sparse hole where the system supports it.
+ * Returns 0 on success.
+ *
+ * (Params)
+ * StreamJob *job		Job the output belongs to
+ * StreamOut *out		Output to write to
+ * unsigned char value	Byte to write
+ * long length			Number of bytes to write
+ */
+int StreamFill(StreamJob *job, StreamOut *out, unsigned char value, long length){
+	unsigned char *buf;
+	size_t n;
+
+	if(length <= 0){
+		return 0;
+	}
+#ifdef ROMWAK_POSIX
+	/* zeros at the end of a file can be a hole: extend it without writing */
+	if(value == 0 && length >= SPARSE_FILL_MIN && out->file != NULL){
+		if(StreamSettle(job,out) != 0){
+			return -1;
+		}
+		if(fflush(out->file) != 0
+		|| ftruncate(fileno(out->file),(off_t)(out->pos+length)) != 0
+		|| fseek(out->file,out->pos+length,SEEK_SET) != 0){
+			JobError(job,"writing",out->what);
+			return -1;
+		}
+		out->pos += length;
+		return 0;
+	}
+#endif
+	buf = StreamBuffer(job,out);
+	if(buf == NULL){
+		return -1;
+	}
+	n = length < STREAM_CHUNK ? (size_t)length : STREAM_CHUNK;
+	memset(buf,value,n);
+
+	while(length > 0){
+		n = length < STREAM_CHUNK ? (size_t)length : STREAM_CHUNK;
+		if(StreamWrite(job,out,buf,n) != 0 || StreamSubmit(job) != 0){
+			return -1;
+		}
+		length -= n;
+	}
+	return 0;
+}
+/*----------------------------------------------------------------------------*/
+
+/* [Kernel Threads]
+ * Kernel units are independent, so a chunk can be split into contiguous
+ * ranges run on several threads (-j, CpuCount()). Ranges start on
+ * KERNEL_ALIGN byte boundaries of every output buffer, which ChunkAlloc()
+ * aligns, so no two threads ever write to the same cache line. Normally a
+ * pool lives for one StreamTransform(); /serve keeps one warm between
+ * requests instead (KernelPoolKeep()).
+ */
+typedef struct {
+	StreamKernel kernel;
+	const void *ctx;
+	size_t inUnit, outUnit;
+	int numIn, numOut;
+	int threads;			/* including the calling thread */
+#ifdef ROMWAK_POSIX
+	int workers;			/* threads started */
+	long align;				/* units per KERNEL_ALIGN bytes of output */
+	const unsigned char **src;	/* current chunk */
+	unsigned char **dst;
+	long units, part;
+	int parts;
+	int next;				/* next part to hand out */
+	int running;			/* parts handed out, not finished yet */
+	bool quit;
+	pthread_mutex_t lock;
+	pthread_cond_t start, done;
+	pthread_t tid[KERNEL_MAX_THREADS];
+#endif
+} KernelPool;
+
+#ifdef ROMWAK_POSIX
+/* KernelPart(KernelPool *pool) - Take the next part of the current chunk and
+ * run it; call with the pool locked. Returns false when none is left. */
+static bool KernelPart(KernelPool *pool){
+	const unsigned char *src[STREAM_MAX_PORTS];
+	unsigned char *dst[STREAM_MAX_PORTS];
+	long first, units;
+	int i;
+
+	if(pool->next >= pool->parts){
+		return false;
+	}
+	first = pool->next++*pool->part;
+	units = pool->units-first < pool->part ? pool->units-first : pool->part;
+	for(i=0;i<pool->numIn;i++){
+		src[i] = pool->src[i]+first*(long)pool->inUnit;
+	}
+	for(i=0;i<pool->numOut;i++){
+		dst[i] = pool->dst[i]+first*(long)pool->outUnit;
+	}
+	pool->running++;
+	pthread_mutex_unlock(&pool->lock);
+
+	if(units > 0){
+		pool->kernel(src,dst,units,pool->ctx);
+	}
+
+	pthread_mutex_lock(&pool->lock);
+	pool->running--;
+	if(pool->running == 0 && pool->next >= pool->parts){
+		pthread_cond_signal(&pool->done);
+	}
+	return true;
+}
+
+static void *KernelWorker(void *arg){
+	KernelPool *pool = (KernelPool*)arg;
+
+	pthread_mutex_lock(&pool->lock);
+	while(!pool->quit){
+		if(!KernelPart(pool)){
+			pthread_cond_wait(&pool->start,&pool->lock);
+		}
+	}
+	pthread_mutex_unlock(&pool->lock);
+	return NULL;
+}
+#endif
+
+#ifdef ROMWAK_POSIX
+static KernelPool warmPool;
+static bool warmKeep = false, warmReady = false, warmBusy = false;
+static pthread_mutex_t warmLock = PTHREAD_MUTEX_INITIALIZER;
+
+/* KernelPoolEnd(KernelPool *pool) - Stop the threads of a pool. */
+static void KernelPoolEnd(KernelPool *pool){
+	int i;
+
+	pthread_mutex_lock(&pool->lock);
+	pool->quit = true;
+	pthread_cond_broadcast(&pool->start);
+	pthread_mutex_unlock(&pool->lock);
+	for(i=0;i<pool->workers;i++){
+		pthread_join(pool->tid[i],NULL);
+	}
+	pthread_cond_destroy(&pool->done);
+	pthread_cond_destroy(&pool->start);
+	pthread_mutex_destroy(&pool->lock);
+}
+#endif
+
+/* KernelPoolStart(KernelPool *own, StreamJob *job, size_t inUnit, size_t outUnit, StreamKernel kernel, const void *ctx, int threads)
+ * Get up to threads threads, counting the caller, ready to run a kernel over
+ * the ports of a job. Ends up with fewer when they can't be had. Returns the
+ * warm pool when one is kept and free, otherwise own with threads of its own.
+ */
+static KernelPool *KernelPoolStart(KernelPool *own, StreamJob *job, size_t inUnit, size_t outUnit, StreamKernel kernel, const void *ctx, int threads){
+	KernelPool *pool = own;
+#ifdef ROMWAK_POSIX
+	int want = threads < KERNEL_MAX_THREADS ? threads : KERNEL_MAX_THREADS;
+	long line = KERNEL_ALIGN;
+	long unit = (long)outUnit;
+
+	pthread_mutex_lock(&warmLock);
+	if(warmKeep && !warmBusy){
+		if(!warmReady){
+			memset(&warmPool,0,sizeof(KernelPool));
+			pthread_mutex_init(&warmPool.lock,NULL);
+			pthread_cond_init(&warmPool.start,NULL);
+			pthread_cond_init(&warmPool.done,NULL);
+			warmReady = true;
+		}
+		warmBusy = true;
+		pool = &warmPool;
+	}
+	pthread_mutex_unlock(&warmLock);
+	if(pool == own){
+		memset(pool,0,sizeof(KernelPool));
+		pthread_mutex_init(&pool->lock,NULL);
+		pthread_cond_init(&pool->start,NULL);
+		pthread_cond_init(&pool->done,NULL);
+	}
+	pthread_mutex_lock(&pool->lock);
+#endif
+
+	pool->kernel = kernel;
+	pool->ctx = ctx;
+	pool->inUnit = inUnit;
+	pool->outUnit = outUnit;
+	pool->numIn = job->numIn;
+	pool->numOut = job->numOut;
+	pool->threads = 1;
+#ifdef ROMWAK_POSIX
+	/* smallest count of units filling whole cache lines: line/gcd(line,unit) */
+	while(unit != 0){
+		long r = line % unit;
+		line = unit;
+		unit = r;
+	}
+	pool->align = KERNEL_ALIGN/line;
+	pool->next = pool->parts = 0;
+	/* a warm pool may already have more threads than this job wants */
+	while(pool->workers < want-1 && pthread_create(&pool->tid[pool->workers],NULL,KernelWorker,pool) == 0){
+		pool->workers++;
+	}
+	pool->threads = pool->workers+1 < want ? pool->workers+1 : want;
+	pthread_mutex_unlock(&pool->lock);
+#else
+	(void)threads;
+#endif
+	return pool;
+}
+
+/* KernelPoolStop(KernelPool *pool) - Let the threads of a pool go, or give
+ * the warm pool back. */
+static void KernelPoolStop(KernelPool *pool){
+#ifdef ROMWAK_POSIX
+	if(pool == &warmPool){
+		pthread_mutex_lock(&warmLock);
+		warmBusy = false;
+		pthread_mutex_unlock(&warmLock);
+		return;
+	}
+	KernelPoolEnd(pool);
+#else
+	(void)pool;
+#endif
+}
+
+/* KernelPoolKeep(bool keep) - Keep a pool of kernel threads between jobs
+ * instead of starting them for every transform, or let it go. */
+void KernelPoolKeep(bool keep){
+#ifdef ROMWAK_POSIX
+	pthread_mutex_lock(&warmLock);
+	warmKeep = keep;
+	if(!keep && warmReady && !warmBusy){
+		KernelPoolEnd(&warmPool);
+		warmReady = false;
+	}
+	pthread_mutex_unlock(&warmLock);
+#else
+	(void)keep;
+#endif
+}
+/*----------------------------------------------------------------------------*/
+
+/* KernelRun(KernelPool *pool, const unsigned char **src, unsigned char **dst, long units)
+ * Run the kernel of a pool over one chunk, with the calling thread taking
+ * parts like the others. Chunks too small to be worth splitting
+ * (KERNEL_PART_MIN bytes of output per thread) run on the calling thread.
+ */
+static void KernelRun(KernelPool *pool, const unsigned char **src, unsigned char **dst, long units){
+#ifdef ROMWAK_POSIX
+	long parts = units*(long)pool->outUnit/KERNEL_PART_MIN;
+
+	if(parts > pool->threads){
+		parts = pool->threads;
+	}
+	if(parts > 1){
+		pthread_mutex_lock(&pool->lock);
+		pool->src = src;
+		pool->dst = dst;
+		pool->units = units;
+		pool->part = (units+parts-1)/parts;
+		pool->part = (pool->part+pool->align-1)/pool->align*pool->align;
+		pool->parts = (int)((units+pool->part-1)/pool->part);
+		pool->next = 0;
+		pthread_cond_broadcast(&pool->start);
+		while(KernelPart(pool))
+			;
+		while(pool->running > 0){
+			pthread_cond_wait(&pool->done,&pool->lock);
+		}
+		pthread_mutex_unlock(&pool->lock);
+		return;
+	}
+#endif
+	pool->kernel(src,dst,units,pool->ctx);
+}
+/*----------------------------------------------------------------------------*/
+
+/* StreamPipeline(StreamJob *job, size_t inUnit, size_t outUnit, long units, KernelPool *pool)
+ * StreamTransform() on three threads: a reader brings chunks in, the calling
+ * thread runs the kernel (with the threads of the pool), a writer sends the
+ * results out. The stages hand
+ * chunks to each other through STREAM_QUEUE slots of preallocated buffers,
+ * so reading, computing and writing overlap and a large file takes about as
+ * long as the slowest of them. Returns 0 on success, -1 on failure, 1 when
+ * the threads or buffers could not be had and nothing was done.
+ */
+#ifdef ROMWAK_POSIX
+#define PIPE_FREE	0		/* slot states, in the order they go round */
+#define PIPE_READ	1
+#define PIPE_DONE	2
+
+typedef struct {
+	StreamJob *job;
+	size_t inUnit, outUnit;
+	long units, perPass;
+	const unsigned char *src[STREAM_QUEUE][STREAM_MAX_PORTS];
+	unsigned char *inBuf[STREAM_QUEUE][STREAM_MAX_PORTS];	/* inputs that aren't mapped */
+	unsigned char *dst[STREAM_QUEUE][STREAM_MAX_PORTS];
+	long count[STREAM_QUEUE];
+	int state[STREAM_QUEUE];
+	pthread_mutex_t lock;
+	pthread_cond_t changed;
+	bool abort;
+	int readErrno;			/* the reader reports here, the job is not its own */
+	int readPort;
+	int writeErrno;			/* errno is per thread; carried back from the writer */
+} StreamPipe;
+
+/* PipeWait(StreamPipe *pipe, int slot, int state) - Wait for a slot to reach
+ * a state. Returns false when the pipeline is aborted instead. */
+static bool PipeWait(StreamPipe *pipe, int slot, int state){
+	bool ok;
+
+	pthread_mutex_lock(&pipe->lock);
+	while(pipe->state[slot] != state && !pipe->abort){
+		pthread_cond_wait(&pipe->changed,&pipe->lock);
+	}
+	ok = !pipe->abort;
+	pthread_mutex_unlock(&pipe->lock);
+	return ok;
+}
+
+/* PipeSet(StreamPipe *pipe, int slot, int state) - Pass a slot on to the next
+ * stage, or abort the pipeline with slot -1. */
+static void PipeSet(StreamPipe *pipe, int slot, int state){
+	pthread_mutex_lock(&pipe->lock);
+	if(slot < 0){
+		pipe->abort = true;
+	}
+	else{
+		pipe->state[slot] = state;
+	}
+	pthread_cond_broadcast(&pipe->changed);
+	pthread_mutex_unlock(&pipe->lock);
+}
+
+static void *PipeReader(void *arg){
+	StreamPipe *pipe = (StreamPipe*)arg;
+	StreamJob *job = pipe->job;
+	volatile unsigned char sink = 0;
+	long units = pipe->units, count, n, j;
+	int slot = 0, i;
+	StreamIn *in;
+
+	while(units > 0 && PipeWait(pipe,slot,PIPE_FREE)){
+		count = units < pipe->perPass ? units : pipe->perPass;
+		n = count*(long)pipe->inUnit;
+		for(i=0;i<job->numIn;i++){
+			in = &job->in[i];
+			if(n > in->length-in->pos){
+				pipe->readErrno = EIO; /* file is shorter than expected */
+			}
+			else if(in->map != NULL){
+				/* fault the chunk in here rather than in the kernel */
+				pipe->src[slot][i] = in->map+in->pos;
+				for(j=0;j<n;j+=PREFETCH_PAGE){
+					sink ^= in->map[in->pos+j];
+				}
+			}
+			else if(fread(pipe->inBuf[slot][i],1,(size_t)n,in->file) != (size_t)n){
+				pipe->readErrno = ferror(in->file) ? errno : EIO;
+			}
+			else{
+				pipe->src[slot][i] = pipe->inBuf[slot][i];
+			}
+			if(pipe->readErrno != 0){
+				pipe->readPort = i;
+				PipeSet(pipe,-1,0);
+				return NULL;
+			}
+			in->pos += n;
+		}
+		pipe->count[slot] = count;
+		PipeSet(pipe,slot,PIPE_READ);
+		units -= count;
+		slot = (slot+1) % STREAM_QUEUE;
+	}
+	(void)sink;
+	return NULL;
+}
+
+static void *PipeWriter(void *arg){
+	StreamPipe *pipe = (StreamPipe*)arg;
+	StreamJob *job = pipe->job;
+	long units = pipe->units;
+	int slot = 0, i;
+
+	while(units > 0 && PipeWait(pipe,slot,PIPE_DONE)){
+		for(i=0;i<job->numOut;i++){
+			if(StreamWrite(job,&job->out[i],pipe->dst[slot][i],pipe->count[slot]*pipe->outUnit) != 0){
+				pipe->writeErrno = errno;
+				PipeSet(pipe,-1,0);
+				return NULL;
+			}
+		}
+		units -= pipe->count[slot];
+		PipeSet(pipe,slot,PIPE_FREE);
+		slot = (slot+1) % STREAM_QUEUE;
+	}
+	return NULL;
+}
+
+/* PipeFree(StreamPipe *pipe) - Release a pipeline and its buffers. */
+static void PipeFree(StreamPipe *pipe){
+	int i, k;
+
+	for(k=0;k<STREAM_QUEUE;k++){
+		for(i=0;i<STREAM_MAX_PORTS;i++){
+			ChunkFree(pipe->inBuf[k][i]);
+			ChunkFree(pipe->dst[k][i]);
+		}
+	}
+	free(pipe);
+}
+
+/* PipeAlloc(StreamJob *job) - A pipeline with buffers for every port of a
+ * job, NULL when short of memory. */
+static StreamPipe *PipeAlloc(StreamJob *job){
+	StreamPipe *pipe = (StreamPipe*)calloc(1,sizeof(StreamPipe));
+	int i, k;
+
+	if(pipe == NULL){
+		return NULL;
+	}
+	for(k=0;k<STREAM_QUEUE;k++){
+		for(i=0;i<job->numIn;i++){
+			if(job->in[i].map == NULL
+			&& (pipe->inBuf[k][i] = ChunkAlloc()) == NULL){
+				PipeFree(pipe);
+				return NULL;
+			}
+		}
+		for(i=0;i<job->numOut;i++){
+			if((pipe->dst[k][i] = ChunkAlloc()) == NULL){
+				PipeFree(pipe);
+				return NULL;
+			}
+		}
+	}
+	pipe->job = job;
+	return pipe;
+}
+
+static int StreamPipeline(StreamJob *job, size_t inUnit, size_t outUnit, long units, KernelPool *pool){
+	StreamPipe *pipe = PipeAlloc(job);
+	pthread_t reader, writer;
+	long startPos[STREAM_MAX_PORTS];
+	long left = units;
+	int status = 1, slot = 0, i;
+
+	if(pipe == NULL){
+		return 1;
+	}
+	pipe->inUnit = inUnit;
+	pipe->outUnit = outUnit;
+	pipe->units = units;
+	pipe->perPass = STREAM_CHUNK/(inUnit > outUnit ? inUnit : outUnit);
+	for(i=0;i<job->numIn;i++){
+		startPos[i] = job->in[i].pos;
+	}
+	pthread_mutex_init(&pipe->lock,NULL);
+	pthread_cond_init(&pipe->changed,NULL);
+
+	if(pthread_create(&reader,NULL,PipeReader,pipe) == 0){
+		if(pthread_create(&writer,NULL,PipeWriter,pipe) == 0){
+			/* the calling thread is the transform stage */
+			while(left > 0 && PipeWait(pipe,slot,PIPE_READ)){
+				KernelRun(pool,pipe->src[slot],pipe->dst[slot],pipe->count[slot]);
+				left -= pipe->count[slot];
+				PipeSet(pipe,slot,PIPE_DONE);
+				slot = (slot+1) % STREAM_QUEUE;
+			}
+			pthread_join(writer,NULL);
+			status = pipe->abort ? -1 : 0;
+		}
+		else{
+			PipeSet(pipe,-1,0);
+		}
+		pthread_join(reader,NULL);
+	}
+
+	if(pipe->readErrno != 0){
+		errno = pipe->readErrno;
+		JobError(job,"reading",job->in[pipe->readPort].what);
+	}
+	else if(pipe->writeErrno != 0){
+		errno = pipe->writeErrno;
+	}
+	else if(status > 0){
+		/* nothing was written; put the inputs back for a run without threads */
+		for(i=0;i<job->numIn;i++){
+			if(StreamSeek(job,&job->in[i],startPos[i]) != 0){
+				status = -1;
+			}
+		}
+	}
+	pthread_cond_destroy(&pipe->changed);
+	pthread_mutex_destroy(&pipe->lock);
+	PipeFree(pipe);
+	return status;
+}
+#endif
+/*----------------------------------------------------------------------------*/
+
+/* TransformChunks(StreamJob *job, size_t inUnit, size_t outUnit, long units, KernelPool *pool)
+ * StreamTransform() one chunk after another on the calling thread.
+ */
+static int TransformChunks(StreamJob *job, size_t inUnit, size_t outUnit, long units, KernelPool *pool){
+	const unsigned char *src[STREAM_MAX_PORTS];
+	unsigned char *dst[STREAM_MAX_PORTS];
+	long perPass = STREAM_CHUNK/(inUnit > outUnit ? inUnit : outUnit);
+	long count;
+	int i;
+
+	memset((void*)src,0,sizeof(src));
+	while(units > 0){
+		count = units < perPass ? units : perPass;
+		for(i=0;i<job->numOut;i++){
+			dst[i] = StreamBuffer(job,&job->out[i]);
+			if(dst[i] == NULL){
+				return -1;
+			}
+		}
+		for(i=0;i<job->numIn;i++){
+			if(StreamRead(job,&job->in[i],count*inUnit,&src[i]) != 0){
+				return -1;
+			}
+		}
+		KernelRun(pool,src,dst,count);
+		for(i=0;i<job->numOut;i++){
+			if(StreamWrite(job,&job->out[i],dst[i],count*outUnit) != 0){
+				return -1;
+			}
+		}
+		/* all outputs of the pass go to the kernel together */
+		if(StreamSubmit(job) != 0){
+			return -1;
+		}
+		units -= count;
+	}
+	return 0;
+}
+/*----------------------------------------------------------------------------*/
+
+/* StreamTransform(StreamJob *job, size_t inUnit, size_t outUnit, long units, StreamKernel kernel, const void *ctx)
+ * Run a kernel over all ports of a job, chunk by chunk. For every unit, the
+ * kernel consumes inUnit bytes from each input and produces outUnit bytes for
+ * each output. With more than one cpu, each chunk is split across threads
+ * and large jobs run as a pipeline (StreamPipeline). Returns 0 on success.
+ *
+ * (Params)
+ * StreamJob *job		Job whose ports are used, in the order they were attached
+ * size_t inUnit		Bytes consumed from each input per unit
+ * size_t outUnit		Bytes produced for each output per unit
+ * long units			Number of units to process
+ * StreamKernel kernel	Transform to run on each chunk
+ * const void *ctx		Passed through to the kernel
+ */
+int StreamTransform(StreamJob *job, size_t inUnit, size_t outUnit, long units, StreamKernel kernel, const void *ctx){
+	long perPass = STREAM_CHUNK/(inUnit > outUnit ? inUnit : outUnit);
+	KernelPool own, *pool;
+	int status = 1;
+
+	pool = KernelPoolStart(&own,job,inUnit,outUnit,kernel,ctx,
+		units*(long)outUnit >= 2*KERNEL_PART_MIN ? CpuCount() : 1);
+#ifdef ROMWAK_POSIX
+	if(units > PIPE_MIN_PASSES*perPass && CpuCount() > 1){
+		status = StreamPipeline(job,inUnit,outUnit,units,pool);
+	}
+#endif
+	if(status > 0){
+		status = TransformChunks(job,inUnit,outUnit,units,pool);
+	}
+	KernelPoolStop(pool);
+	return status;
+}
+/*----------------------------------------------------------------------------*/
+
+/* [Memory Files]
+ * While /batch runs, paths starting with '@' name buffers that live in
+ * memory, so intermediate results chain from one command to the next
+ * without touching disk. Jobs that write one build a fresh buffer that
+ * JobClose() publishes under the name, replacing the previous contents.
+ */
+static MemFile *memFiles = NULL;
+static bool memFilesEnabled = false;
+#ifdef ROMWAK_POSIX
+static pthread_mutex_t memFilesLock = PTHREAD_MUTEX_INITIALIZER;
+#define MEMFILES_LOCK()		pthread_mutex_lock(&memFilesLock)
+#define MEMFILES_UNLOCK()	pthread_mutex_unlock(&memFilesLock)
+#else
+#define MEMFILES_LOCK()
+#define MEMFILES_UNLOCK()
+#endif
+
+static void MemFileFree(MemFile *f){
+	free(f->data);
+	free(f->name);
+	free(f);
+}
+
+/* MemFileEnable(bool enable) - Turn '@' names on, or off again, dropping
+ * every in-memory file. */
+void MemFileEnable(bool enable){
+	MemFile *f;
+
+	MEMFILES_LOCK();
+	memFilesEnabled = enable;
+	while(!enable && memFiles != NULL){
+		f = memFiles;
+		memFiles = f->next;
+		MemFileFree(f);
+	}
+	MEMFILES_UNLOCK();
+}
+/*----------------------------------------------------------------------------*/
+
+/* MemFileName(const char *path) - Whether path names an in-memory file. */
+bool MemFileName(const char *path){
+	return memFilesEnabled && path != NULL && path[0] == '@';
+}
+/*----------------------------------------------------------------------------*/
+
+/* MemFileFind(const char *name) - Look up a published in-memory file.
+ * Returns NULL if there is none. */
+MemFile *MemFileFind(const char *name){
+	MemFile *f;
+
+	MEMFILES_LOCK();
+	for(f=memFiles;f != NULL && strcmp(f->name,name) != 0;f=f->next)
+		;
+	MEMFILES_UNLOCK();
+	return f;
+}
+/*----------------------------------------------------------------------------*/
+
+/* MemFilePublish(MemFile *file, bool keep) - Called by JobClose() for an
+ * in-memory output: make it visible under its name, replacing the old
+ * contents, or discard it when keep is false. */
+void MemFilePublish(MemFile *file, bool keep){
+	MemFile **link;
+
+	if(!keep){
+		MemFileFree(file);
+		return;
+	}
+	MEMFILES_LOCK();
+	for(link=&memFiles;*link != NULL;link=&(*link)->next){
+		if(strcmp((*link)->name,file->name) == 0){
+			file->next = (*link)->next;
+			MemFileFree(*link);
+			*link = file;
+			MEMFILES_UNLOCK();
+			return;
+		}
+	}
+	file->next = memFiles;
+	memFiles = file;
+	MEMFILES_UNLOCK();
+}
+/*----------------------------------------------------------------------------*/
+
+/* MemFileDrop(const char *name) - Free an in-memory file nobody needs anymore. */
+void MemFileDrop(const char *name){
+	MemFile **link, *f;
+
+	MEMFILES_LOCK();
+	for(link=&memFiles;*link != NULL;link=&(*link)->next){
+		if(strcmp((*link)->name,name) == 0){
+			f = *link;
+			*link = f->next;
+			MemFileFree(f);
+			break;
+		}
+	}
+	MEMFILES_UNLOCK();
+}
+/*----------------------------------------------------------------------------*/
+
+/* [SIMD Kernels]
+ * Vector versions of the hot loops. The best one for the running CPU is
+ * picked on first use; the scalar loop stays as the fallback. Setting the
+ * ROMWAK_NO_SIMD environment variable forces the scalar code.
+ */
+
+/* CpuFeatures() - Returns the CPU_* flags usable on this machine.
+ * Detected once, whichever thread asks first. */
+static int cpuFeatures = 0;
+#ifdef ROMWAK_POSIX
+static pthread_once_t cpuFeaturesOnce = PTHREAD_ONCE_INIT;
+#else
+static bool cpuFeaturesDone = false;	/* single threaded without pthreads */
+#endif
+
+static void CpuFeaturesDetect(void){
+	int features = 0;
+
+	if(getenv("ROMWAK_NO_SIMD") == NULL){
+#ifdef ROMWAK_X86
+		__builtin_cpu_init();
+		if(__builtin_cpu_supports("sse2")){
+			features |= CPU_SSE2;
+		}
+		if(__builtin_cpu_supports("ssse3")){
+			features |= CPU_SSSE3;
+		}
+		if(__builtin_cpu_supports("avx2")){
+			features |= CPU_AVX2;
+		}
+		if(__builtin_cpu_supports("pclmul") && (features & CPU_SSSE3)){
+			features |= CPU_CLMUL;
+		}
+#endif
+#ifdef ROMWAK_NEON
+		features |= CPU_NEON;
+#endif
+#ifdef ROMWAK_PMULL
+		if(getauxval(AT_HWCAP) & HWCAP_PMULL){
+			features |= CPU_CLMUL;
+		}
+#endif
+	}
+	cpuFeatures = features;
+}
+
+int CpuFeatures(void){
+#ifdef ROMWAK_POSIX
+	pthread_once(&cpuFeaturesOnce,CpuFeaturesDetect);
+#else
+	if(!cpuFeaturesDone){
+		cpuFeaturesDone = true;
+		CpuFeaturesDetect();
+	}
+#endif
+	return cpuFeatures;
+}
+
+/* CpuCount() - Threads to use for parallel work: the -j option if given,
+ * else ROMWAK_THREADS if set, otherwise the number of online cpus.
+ * CpuCountSet(int threads) - Set it from the -j option. */
+static int cpuCount = 0;
+
+void CpuCountSet(int threads){
+	cpuCount = threads > 0 ? threads : 1;
+}
+
+int CpuCount(void){
+	int count = cpuCount;
+	const char *env;
+
+	if(count == 0){
+		env = getenv("ROMWAK_THREADS");
+		if(env != NULL){
+			count = atoi(env);
+		}
+#if defined(ROMWAK_POSIX) && defined(_SC_NPROCESSORS_ONLN)
+		else{
+			count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+		}
+#endif
+		if(count < 1){
+			count = 1;
+		}
+		cpuCount = count;
+	}
+	return count;
+}
+/*----------------------------------------------------------------------------*/
+
+/* DeinterleaveBytes(const unsigned char *in, unsigned char *outA, unsigned char *outB, long count)
+ * Even bytes of in go to outA, odd bytes to outB; count bytes each.
+ * Dispatches to the best implementation on first call.
+ */
+void DeinterleaveBytesScalar(const unsigned char *in, unsigned char *outA, unsigned char *outB, long count){
+	long i;
+
+	for(i=0;i<count;i++){
+		outA[i] = in[i*2];
+		outB[i] = in[i*2+1];
+	}
+}
+
+#ifdef ROMWAK_X86
+__attribute__((target("sse2")))
+void DeinterleaveBytesSSE2(const unsigned char *in, unsigned char *outA, unsigned char *outB, long count){
+	const __m128i low = _mm_set1_epi16(0x00ff);
+	__m128i a, b;
+	long i;
+
+	for(i=0;i+16<=count;i+=16){
+		a = _mm_loadu_si128((const __m128i*)(in+i*2));
+		b = _mm_loadu_si128((const __m128i*)(in+i*2+16));
+		_mm_storeu_si128((__m128i*)(outA+i),_mm_packus_epi16(_mm_and_si128(a,low),_mm_and_si128(b,low)));
+		_mm_storeu_si128((__m128i*)(outB+i),_mm_packus_epi16(_mm_srli_epi16(a,8),_mm_srli_epi16(b,8)));
+	}
+	DeinterleaveBytesScalar(in+i*2,outA+i,outB+i,count-i);
+}
+
+__attribute__((target("avx2")))
+void DeinterleaveBytesAVX2(const unsigned char *in, unsigned char *outA, unsigned char *outB, long count){
+	const __m256i low = _mm256_set1_epi16(0x00ff);
+	__m256i a, b, even, odd;
+	long i;
+
+	for(i=0;i+32<=count;i+=32){
+		a = _mm256_loadu_si256((const __m256i*)(in+i*2));
+		b = _mm256_loadu_si256((const __m256i*)(in+i*2+32));
+		/* packus works per 128-bit lane, put the quadwords back in order */
+		even = _mm256_packus_epi16(_mm256_and_si256(a,low),_mm256_and_si256(b,low));
+		odd = _mm256_packus_epi16(_mm256_srli_epi16(a,8),_mm256_srli_epi16(b,8));
+		_mm256_storeu_si256((__m256i*)(outA+i),_mm256_permute4x64_epi64(even,0xd8));
+		_mm256_storeu_si256((__m256i*)(outB+i),_mm256_permute4x64_epi64(odd,0xd8));
+	}
+	DeinterleaveBytesSSE2(in+i*2,outA+i,outB+i,count-i);
+}
+#endif
+
+#ifdef ROMWAK_NEON
+void DeinterleaveBytesNEON(const unsigned char *in, unsigned char *outA, unsigned char *outB, long count){
+	uint8x16x2_t v;
+	long i;
+
+	for(i=0;i+16<=count;i+=16){
+		v = vld2q_u8(in+i*2);
+		vst1q_u8(outA+i,v.val[0]);
+		vst1q_u8(outB+i,v.val[1]);
+	}
+	DeinterleaveBytesScalar(in+i*2,outA+i,outB+i,count-i);
+}
+#endif
+
+void DeinterleaveBytesDispatch(const unsigned char *in, unsigned char *outA, unsigned char *outB, long count){
+	int features = CpuFeatures();
+
+	DeinterleaveBytes = DeinterleaveBytesScalar;
+#ifdef ROMWAK_X86
+	if(features & CPU_AVX2){
+		DeinterleaveBytes = DeinterleaveBytesAVX2;
+	}
+	else if(features & CPU_SSE2){
+		DeinterleaveBytes = DeinterleaveBytesSSE2;
+	}
+#endif
+#ifdef ROMWAK_NEON
+	if(features & CPU_NEON){
+		DeinterleaveBytes = DeinterleaveBytesNEON;
+	}
+#endif
+	(void)features;
+	DeinterleaveBytes(in,outA,outB,count);
+}
+
+void (*DeinterleaveBytes)(const unsigned char *in, unsigned char *outA, unsigned char *outB, long count) = DeinterleaveBytesDispatch;
+/*----------------------------------------------------------------------------*/
+
+/* DeinterleaveWords(const unsigned char *in, unsigned char *outA, unsigned char *outB, long count)
+ * Even 16-bit words of in go to outA, odd words to outB; count words each.
+ * Usable by anything that splits 16-bit lanes. Dispatches on first call.
+ */
+void DeinterleaveWordsScalar(const unsigned char *in, unsigned char *outA, unsigned char *outB, long count){
+	long i;
+
+	for(i=0;i<count;i++){
+		outA[i*2] = in[i*4];
+		outA[i*2+1] = in[i*4+1];
+		outB[i*2] = in[i*4+2];
+		outB[i*2+1] = in[i*4+3];
+	}
+}
+
+#ifdef ROMWAK_X86
+/* SSE2 has no unsigned 32->16 pack, so the words are sign extended first;
+ * the signed pack then never saturates and gives the words back unchanged. */
+__attribute__((target("sse2")))
+void DeinterleaveWordsSSE2(const unsigned char *in, unsigned char *outA, unsigned char *outB, long count){
+	__m128i a, b;
+	long i;
+
+	for(i=0;i+8<=count;i+=8){
+		a = _mm_loadu_si128((const __m128i*)(in+i*4));
+		b = _mm_loadu_si128((const __m128i*)(in+i*4+16));
+		_mm_storeu_si128((__m128i*)(outA+i*2),_mm_packs_epi32(
+			_mm_srai_epi32(_mm_slli_epi32(a,16),16),_mm_srai_epi32(_mm_slli_epi32(b,16),16)));
+		_mm_storeu_si128((__m128i*)(outB+i*2),_mm_packs_epi32(_mm_srai_epi32(a,16),_mm_srai_epi32(b,16)));
+	}
+	DeinterleaveWordsScalar(in+i*4,outA+i*2,outB+i*2,count-i);
+}
+
+__attribute__((target("avx2")))
+void DeinterleaveWordsAVX2(const unsigned char *in, unsigned char *outA, unsigned char *outB, long count){
+	__m256i a, b, even, odd;
+	long i;
+
+	for(i=0;i+16<=count;i+=16){
+		a = _mm256_loadu_si256((const __m256i*)(in+i*4));
+		b = _mm256_loadu_si256((const __m256i*)(in+i*4+32));
+		even = _mm256_packs_epi32(_mm256_srai_epi32(_mm256_slli_epi32(a,16),16),
+			_mm256_srai_epi32(_mm256_slli_epi32(b,16),16));
+		odd = _mm256_packs_epi32(_mm256_srai_epi32(a,16),_mm256_srai_epi32(b,16));
+		_mm256_storeu_si256((__m256i*)(outA+i*2),_mm256_permute4x64_epi64(even,0xd8));
+		_mm256_storeu_si256((__m256i*)(outB+i*2),_mm256_permute4x64_epi64(odd,0xd8));
+	}
+	DeinterleaveWordsSSE2(in+i*4,outA+i*2,outB+i*2,count-i);
+}
+#endif
+
+#ifdef ROMWAK_NEON
+void DeinterleaveWordsNEON(const unsigned char *in, unsigned char *outA, unsigned char *outB, long count){
+	uint16x8x2_t v;
+	long i;
+
+	for(i=0;i+8<=count;i+=8){
+		v = vld2q_u16((const uint16_t*)(in+i*4));
+		vst1q_u16((uint16_t*)(outA+i*2),v.val[0]);
+		vst1q_u16((uint16_t*)(outB+i*2),v.val[1]);
+	}
+	DeinterleaveWordsScalar(in+i*4,outA+i*2,outB+i*2,count-i);
+}
+#endif
+
+void DeinterleaveWordsDispatch(const unsigned char *in, unsigned char *outA, unsigned char *outB, long count){
+	int features = CpuFeatures();
+
+	DeinterleaveWords = DeinterleaveWordsScalar;
+#ifdef ROMWAK_X86
+	if(features & CPU_AVX2){
+		DeinterleaveWords = DeinterleaveWordsAVX2;
+	}
+	else if(features & CPU_SSE2){
+		DeinterleaveWords = DeinterleaveWordsSSE2;
+	}
+#endif
+#ifdef ROMWAK_NEON
+	if(features & CPU_NEON){
+		DeinterleaveWords = DeinterleaveWordsNEON;
+	}
+#endif
+	(void)features;
+	DeinterleaveWords(in,outA,outB,count);
+}
+
+void (*DeinterleaveWords)(const unsigned char *in, unsigned char *outA, unsigned char *outB, long count) = DeinterleaveWordsDispatch;
+/*----------------------------------------------------------------------------*/
+
+/* InterleaveBytes(const unsigned char *inA, const unsigned char *inB, unsigned char *out, long count)
+ * Zips count bytes of inA and inB into out (A0 B0 A1 B1 ...).
+ * Dispatches on first call.
+ */
+void InterleaveBytesScalar(const unsigned char *inA, const unsigned char *inB, unsigned char *out, long count){
+	long i;
+
+	for(i=0;i<count;i++){
+		out[i*2] = inA[i];
+		out[i*2+1] = inB[i];
+	}
+}
+
+#ifdef ROMWAK_X86
+__attribute__((target("sse2")))
+void InterleaveBytesSSE2(const unsigned char *inA, const unsigned char *inB, unsigned char *out, long count){
+	__m128i a, b;
+	long i;
+
+	for(i=0;i+16<=count;i+=16){
+		a = _mm_loadu_si128((const __m128i*)(inA+i));
+		b = _mm_loadu_si128((const __m128i*)(inB+i));
+		_mm_storeu_si128((__m128i*)(out+i*2),_mm_unpacklo_epi8(a,b));
+		_mm_storeu_si128((__m128i*)(out+i*2+16),_mm_unpackhi_epi8(a,b));
+	}
+	InterleaveBytesScalar(inA+i,inB+i,out+i*2,count-i);
+}
+
+__attribute__((target("avx2")))
+void InterleaveBytesAVX2(const unsigned char *inA, const unsigned char *inB, unsigned char *out, long count){
+	__m256i a, b, lo, hi;
+	long i;
+
+	for(i=0;i+32<=count;i+=32){
+		a = _mm256_loadu_si256((const __m256i*)(inA+i));
+		b = _mm256_loadu_si256((const __m256i*)(inB+i));
+		/* unpack works per 128-bit lane, recombine the halves in order */
+		lo = _mm256_unpacklo_epi8(a,b);
+		hi = _mm256_unpackhi_epi8(a,b);
+		_mm256_storeu_si256((__m256i*)(out+i*2),_mm256_permute2x128_si256(lo,hi,0x20));
+		_mm256_storeu_si256((__m256i*)(out+i*2+32),_mm256_permute2x128_si256(lo,hi,0x31));
+	}
+	InterleaveBytesSSE2(inA+i,inB+i,out+i*2,count-i);
+}
+#endif
+
+#ifdef ROMWAK_NEON
+void InterleaveBytesNEON(const unsigned char *inA, const unsigned char *inB, unsigned char *out, long count){
+	uint8x16x2_t v;
+	long i;
+
+	for(i=0;i+16<=count;i+=16){
+		v.val[0] = vld1q_u8(inA+i);
+		v.val[1] = vld1q_u8(inB+i);
+		vst2q_u8(out+i*2,v);
+	}
+	InterleaveBytesScalar(inA+i,inB+i,out+i*2,count-i);
+}
+#endif
+
+void InterleaveBytesDispatch(const unsigned char *inA, const unsigned char *inB, unsigned char *out, long count){
+	int features = CpuFeatures();
+
+	InterleaveBytes = InterleaveBytesScalar;
+#ifdef ROMWAK_X86
+	if(features & CPU_AVX2){
+		InterleaveBytes = InterleaveBytesAVX2;
+	}
+	else if(features & CPU_SSE2){
+		InterleaveBytes = InterleaveBytesSSE2;
+	}
+#endif
+#ifdef ROMWAK_NEON
+	if(features & CPU_NEON){
+		InterleaveBytes = InterleaveBytesNEON;
+	}
+#endif
+	(void)features;
+	InterleaveBytes(inA,inB,out,count);
+}
+
+void (*InterleaveBytes)(const unsigned char *inA, const unsigned char *inB, unsigned char *out, long count) = InterleaveBytesDispatch;
+/*----------------------------------------------------------------------------*/
+
+/* InterleaveBytesQuad(const unsigned char **in, unsigned char *out, long count)
+ * Zips count bytes of in[0..3] into out (A0 B0 C0 D0 A1 B1 ...).
+ * Dispatches on first call.
+ */
+void InterleaveBytesQuadScalar(const unsigned char **in, unsigned char *out, long count){
+	long i;
+
+	for(i=0;i<count;i++){
+		out[i*4] = in[0][i];
+		out[i*4+1] = in[1][i];
+		out[i*4+2] = in[2][i];
+		out[i*4+3] = in[3][i];
+	}
+}
+
+/* Tail helper for the vector versions: the remaining count bytes from offset i */
+static void InterleaveBytesQuadTail(const unsigned char **in, unsigned char *out, long i, long count){
+	const unsigned char *tail[4];
+
+	tail[0] = in[0]+i;
+	tail[1] = in[1]+i;
+	tail[2] = in[2]+i;
+	tail[3] = in[3]+i;
+	InterleaveBytesQuadScalar(tail,out+i*4,count-i);
+}
+
+#ifdef ROMWAK_X86
+__attribute__((target("sse2")))
+void InterleaveBytesQuadSSE2(const unsigned char **in, unsigned char *out, long count){
+	__m128i a, b, c, d, abLo, abHi, cdLo, cdHi;
+	long i;
+
+	for(i=0;i+16<=count;i+=16){
+		a = _mm_loadu_si128((const __m128i*)(in[0]+i));
+		b = _mm_loadu_si128((const __m128i*)(in[1]+i));
+		c = _mm_loadu_si128((const __m128i*)(in[2]+i));
+		d = _mm_loadu_si128((const __m128i*)(in[3]+i));
+		/* byte pairs first, then pairs of pairs */
+		abLo = _mm_unpacklo_epi8(a,b);
+		abHi = _mm_unpackhi_epi8(a,b);
+		cdLo = _mm_unpacklo_epi8(c,d);
+		cdHi = _mm_unpackhi_epi8(c,d);
+		_mm_storeu_si128((__m128i*)(out+i*4),_mm_unpacklo_epi16(abLo,cdLo));
+		_mm_storeu_si128((__m128i*)(out+i*4+16),_mm_unpackhi_epi16(abLo,cdLo));
+		_mm_storeu_si128((__m128i*)(out+i*4+32),_mm_unpacklo_epi16(abHi,cdHi));
+		_mm_storeu_si128((__m128i*)(out+i*4+48),_mm_unpackhi_epi16(abHi,cdHi));
+	}
+	InterleaveBytesQuadTail(in,out,i,count);
+}
+
+__attribute__((target("avx2")))
+void InterleaveBytesQuadAVX2(const unsigned char **in, unsigned char *out, long count){
+	__m256i a, b, c, d, abLo, abHi, cdLo, cdHi, r0, r1, r2, r3;
+	long i;
+
+	for(i=0;i+32<=count;i+=32){
+		a = _mm256_loadu_si256((const __m256i*)(in[0]+i));
+		b = _mm256_loadu_si256((const __m256i*)(in[1]+i));
+		c = _mm256_loadu_si256((const __m256i*)(in[2]+i));
+		d = _mm256_loadu_si256((const __m256i*)(in[3]+i));
+		abLo = _mm256_unpacklo_epi8(a,b);
+		abHi = _mm256_unpackhi_epi8(a,b);
+		cdLo = _mm256_unpacklo_epi8(c,d);
+		cdHi = _mm256_unpackhi_epi8(c,d);
+		/* each result holds bytes 0-15 in its low lane and 16-31 in its high lane */
+		r0 = _mm256_unpacklo_epi16(abLo,cdLo);
+		r1 = _mm256_unpackhi_epi16(abLo,cdLo);
+		r2 = _mm256_unpacklo_epi16(abHi,cdHi);
+		r3 = _mm256_unpackhi_epi16(abHi,cdHi);
+		_mm256_storeu_si256((__m256i*)(out+i*4),_mm256_permute2x128_si256(r0,r1,0x20));
+		_mm256_storeu_si256((__m256i*)(out+i*4+32),_mm256_permute2x128_si256(r2,r3,0x20));
+		_mm256_storeu_si256((__m256i*)(out+i*4+64),_mm256_permute2x128_si256(r0,r1,0x31));
+		_mm256_storeu_si256((__m256i*)(out+i*4+96),_mm256_permute2x128_si256(r2,r3,0x31));
+	}
+	InterleaveBytesQuadTail(in,out,i,count);
+}
+#endif
+
+#ifdef ROMWAK_NEON
+void InterleaveBytesQuadNEON(const unsigned char **in, unsigned char *out, long count){
+	uint8x16x4_t v;
+	long i;
+
+	for(i=0;i+16<=count;i+=16){
+		v.val[0] = vld1q_u8(in[0]+i);
+		v.val[1] = vld1q_u8(in[1]+i);
+		v.val[2] = vld1q_u8(in[2]+i);
+		v.val[3] = vld1q_u8(in[3]+i);
+		vst4q_u8(out+i*4,v);
+	}
+	InterleaveBytesQuadTail(in,out,i,count);
+}
+#endif
+
+void InterleaveBytesQuadDispatch(const unsigned char **in, unsigned char *out, long count){
+	int features = CpuFeatures();
+
+	InterleaveBytesQuad = InterleaveBytesQuadScalar;
+#ifdef ROMWAK_X86
+	if(features & CPU_AVX2){
+		InterleaveBytesQuad = InterleaveBytesQuadAVX2;
+	}
+	else if(features & CPU_SSE2){
+		InterleaveBytesQuad = InterleaveBytesQuadSSE2;
+	}
+#endif
+#ifdef ROMWAK_NEON
+	if(features & CPU_NEON){
+		InterleaveBytesQuad = InterleaveBytesQuadNEON;
+	}
+#endif
+	(void)features;
+	InterleaveBytesQuad(in,out,count);
+}
+
+void (*InterleaveBytesQuad)(const unsigned char **in, unsigned char *out, long count) = InterleaveBytesQuadDispatch;
+/*----------------------------------------------------------------------------*/
+
+/* SwapBytes(const unsigned char *in, unsigned char *out, long count, int width)
+ * Reverses the byte order of count elements of width bytes (2, 4 or 8).
+ * in and out may be the same buffer. Dispatches on first call.
+ */
+void SwapBytesScalar(const unsigned char *in, unsigned char *out, long count, int width){
+	unsigned char a, b;
+	long i;
+	int j;
+
+	for(i=0;i<count*width;i+=width){
+		for(j=0;j<width/2;j++){
+			a = in[i+j];
+			b = in[i+width-1-j];
+			out[i+j] = b;
+			out[i+width-1-j] = a;
+		}
+	}
+}
+
+/* SwapMask(unsigned char *mask, int width) - pshufb pattern reversing each element */
+static void SwapMask(unsigned char *mask, int width){
+	int j;
+
+	for(j=0;j<16;j++){
+		mask[j] = (unsigned char)((j/width)*width+(width-1-j%width));
+	}
+}
+
+#ifdef ROMWAK_X86
+__attribute__((target("ssse3")))
+void SwapBytesSSSE3(const unsigned char *in, unsigned char *out, long count, int width){
+	unsigned char pattern[16];
+	__m128i mask;
+	long i, length = count*width;
+
+	SwapMask(pattern,width);
+	mask = _mm_loadu_si128((const __m128i*)pattern);
+	for(i=0;i+16<=length;i+=16){
+		_mm_storeu_si128((__m128i*)(out+i),_mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(in+i)),mask));
+	}
+	SwapBytesScalar(in+i,out+i,(length-i)/width,width);
+}
+
+__attribute__((target("avx2")))
+void SwapBytesAVX2(const unsigned char *in, unsigned char *out, long count, int width){
+	unsigned char pattern[16];
+	__m256i mask;
+	long i, length = count*width;
+
+	/* elements never cross a 128-bit lane, so the same pattern works in both */
+	SwapMask(pattern,width);
+	mask = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)pattern));
+	for(i=0;i+32<=length;i+=32){
+		_mm256_storeu_si256((__m256i*)(out+i),_mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)(in+i)),mask));
+	}
+	SwapBytesScalar(in+i,out+i,(length-i)/width,width);
+}
+#endif
+
+#ifdef ROMWAK_NEON
+void SwapBytesNEON(const unsigned char *in, unsigned char *out, long count, int width){
+	uint8x16_t v;
+	long i, length = count*width;
+
+	for(i=0;i+16<=length;i+=16){
+		v = vld1q_u8(in+i);
+		if(width == 2){
+			v = vrev16q_u8(v);
+		}
+		else if(width == 4){
+			v = vrev32q_u8(v);
+		}
+		else{
+			v = vrev64q_u8(v);
+		}
+		vst1q_u8(out+i,v);
+	}
+	SwapBytesScalar(in+i,out+i,(length-i)/width,width);
+}
+#endif
+
+void SwapBytesDispatch(const unsigned char *in, unsigned char *out, long count, int width){
+	int features = CpuFeatures();
+
+	SwapBytes = SwapBytesScalar;
+#ifdef ROMWAK_X86
+	if(features & CPU_AVX2){
+		SwapBytes = SwapBytesAVX2;
+	}
+	else if(features & CPU_SSSE3){
+		SwapBytes = SwapBytesSSSE3;
+	}
+#endif
+#ifdef ROMWAK_NEON
+	if(features & CPU_NEON){
+		SwapBytes = SwapBytesNEON;
+	}
+#endif
+	(void)features;
+	SwapBytes(in,out,count,width);
+}
+
+void (*SwapBytes)(const unsigned char *in, unsigned char *out, long count, int width) = SwapBytesDispatch;
+/*----------------------------------------------------------------------------*/
+
+/* CrcFold(const unsigned char *data, long length, unsigned long crc, int reflected, unsigned char *rem)
+ * Carry-less multiply folding for the 32-bit crcs. Folds the bulk of data
+ * (with crc already mixed into its first 4 bytes) down to a 16 byte
+ * remainder stored in rem, in data order. The table crc of rem from 0,
+ * continued over the unconsumed tail, is the crc of the whole block.
+ * Returns the number of bytes consumed, 0 if nothing was folded.
+ * reflected selects the zip (lsb first) bit order instead of POLYNOMIAL's.
+ */
+long CrcFoldScalar(const unsigned char *data, long length, unsigned long crc, int reflected, unsigned char *rem){
+	(void)data; (void)length; (void)crc; (void)reflected; (void)rem;
+	return 0;
+}
+
+/* folding constants, x^n mod P: {low qword, high qword} for one 16 byte
+ * step and for a 64 byte step. Msb first data is byteswapped so the high
+ * qword carries the higher powers; lsb first data keeps the low qword
+ * high, and its constants are reflected and one power lower to absorb the
+ * extra shift of a reflected carry-less product. */
+static const unsigned long crcFoldK[2][2][2] = {
+	{ {0xe8a45605UL, 0xc5b9cd4cUL}, {0xe6228b11UL, 0x8833794cUL} },	/* x^128,x^192 / x^512,x^576 */
+	{ {0x65673b46UL, 0x9ba54c6fUL}, {0x653d9822UL, 0xcad38e8fUL} }		/* x^191,x^127 / x^575,x^511 */
+};
+
+#ifdef ROMWAK_X86
+__attribute__((target("pclmul,ssse3")))
+static __m128i CrcFoldStepPCLMUL(__m128i x, __m128i k, __m128i next){
+	return _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x,k,0x00),_mm_clmulepi64_si128(x,k,0x11)),next);
+}
+
+__attribute__((target("pclmul,ssse3")))
+long CrcFoldPCLMUL(const unsigned char *data, long length, unsigned long crc, int reflected, unsigned char *rem){
+	const unsigned long (*k)[2] = crcFoldK[reflected != 0];
+	__m128i order, k1, k4, x0, x1, x2, x3;
+	long i;
+
+	if(length < 128){
+		return 0;
+	}
+	/* byte order of each 16 byte load; reflected data is used as is */
+	order = reflected ? _mm_setr_epi8(0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15)
+	                  : _mm_setr_epi8(15,14,13,12,11,10,9,8,7,6,5,4,3,2,1,0);
+	/* reflected constants keep their 32 significant bits in the top half */
+	if(reflected){
+		k1 = _mm_set_epi32((int)k[0][1],0,(int)k[0][0],0);
+		k4 = _mm_set_epi32((int)k[1][1],0,(int)k[1][0],0);
+	}
+	else{
+		k1 = _mm_set_epi32(0,(int)k[0][1],0,(int)k[0][0]);
+		k4 = _mm_set_epi32(0,(int)k[1][1],0,(int)k[1][0]);
+	}
+
+	x0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)data),order);
+	x1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data+16)),order);
+	x2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data+32)),order);
+	x3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data+48)),order);
+	x0 = _mm_xor_si128(x0,reflected ? _mm_cvtsi32_si128((int)crc) : _mm_set_epi32((int)crc,0,0,0));
+
+	for(i=64;i+64<=length;i+=64){
+		x0 = CrcFoldStepPCLMUL(x0,k4,_mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data+i)),order));
+		x1 = CrcFoldStepPCLMUL(x1,k4,_mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data+i+16)),order));
+		x2 = CrcFoldStepPCLMUL(x2,k4,_mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data+i+32)),order));
+		x3 = CrcFoldStepPCLMUL(x3,k4,_mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data+i+48)),order));
+	}
+	x0 = CrcFoldStepPCLMUL(x0,k1,x1);
+	x0 = CrcFoldStepPCLMUL(x0,k1,x2);
+	x0 = CrcFoldStepPCLMUL(x0,k1,x3);
+	for(;i+16<=length;i+=16){
+		x0 = CrcFoldStepPCLMUL(x0,k1,_mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data+i)),order));
+	}
+
+	_mm_storeu_si128((__m128i*)rem,_mm_shuffle_epi8(x0,order));
+	return i;
+}
+#endif
+
+#ifdef ROMWAK_PMULL
+__attribute__((target("+crypto")))
+static uint8x16_t CrcFoldStepPMULL(uint8x16_t x, const poly64_t *k, uint8x16_t next){
+	poly64x2_t v = vreinterpretq_p64_u8(x);
+	uint8x16_t lo = vreinterpretq_u8_p128(vmull_p64(vgetq_lane_p64(v,0),k[0]));
+	uint8x16_t hi = vreinterpretq_u8_p128(vmull_p64(vgetq_lane_p64(v,1),k[1]));
+
+	return veorq_u8(veorq_u8(lo,hi),next);
+}
+
+__attribute__((target("+crypto")))
+static uint8x16_t CrcFoldLoadPMULL(const unsigned char *data, int reflected){
+	uint8x16_t v = vld1q_u8(data);
+
+	/* little endian lanes: msb first data is byteswapped end to end */
+	return reflected ? v : vextq_u8(vrev64q_u8(v),vrev64q_u8(v),8);
+}
+
+__attribute__((target("+crypto")))
+long CrcFoldPMULL(const unsigned char *data, long length, unsigned long crc, int reflected, unsigned char *rem){
+	const unsigned long (*k)[2] = crcFoldK[reflected != 0];
+	poly64_t k1[2], k4[2];
+	uint8x16_t x0, x1, x2, x3;
+	uint32x4_t c = vdupq_n_u32(0);
+	long i;
+
+	if(length < 128){
+		return 0;
+	}
+	for(i=0;i<2;i++){
+		k1[i] = (poly64_t)(reflected ? (unsigned long long)k[0][i] << 32 : k[0][i]);
+		k4[i] = (poly64_t)(reflected ? (unsigned long long)k[1][i] << 32 : k[1][i]);
+	}
+
+	x0 = CrcFoldLoadPMULL(data,reflected);
+	x1 = CrcFoldLoadPMULL(data+16,reflected);
+	x2 = CrcFoldLoadPMULL(data+32,reflected);
+	x3 = CrcFoldLoadPMULL(data+48,reflected);
+	c = reflected ? vsetq_lane_u32((unsigned int)crc,c,0) : vsetq_lane_u32((unsigned int)crc,c,3);
+	x0 = veorq_u8(x0,vreinterpretq_u8_u32(c));
+
+	for(i=64;i+64<=length;i+=64){
+		x0 = CrcFoldStepPMULL(x0,k4,CrcFoldLoadPMULL(data+i,reflected));
+		x1 = CrcFoldStepPMULL(x1,k4,CrcFoldLoadPMULL(data+i+16,reflected));
+		x2 = CrcFoldStepPMULL(x2,k4,CrcFoldLoadPMULL(data+i+32,reflected));
+		x3 = CrcFoldStepPMULL(x3,k4,CrcFoldLoadPMULL(data+i+48,reflected));
+	}
+	x0 = CrcFoldStepPMULL(x0,k1,x1);
+	x0 = CrcFoldStepPMULL(x0,k1,x2);
+	x0 = CrcFoldStepPMULL(x0,k1,x3);
+	for(;i+16<=length;i+=16){
+		x0 = CrcFoldStepPMULL(x0,k1,CrcFoldLoadPMULL(data+i,reflected));
+	}
+
+	vst1q_u8(rem,reflected ? x0 : vextq_u8(vrev64q_u8(x0),vrev64q_u8(x0),8));
+	return i;
+}
+#endif
+
+long CrcFoldDispatch(const unsigned char *data, long length, unsigned long crc, int reflected, unsigned char *rem){
+	int features = CpuFeatures();
+
+	CrcFold = CrcFoldScalar;
+#ifdef ROMWAK_X86
+	if(features & CPU_CLMUL){
+		CrcFold = CrcFoldPCLMUL;
+	}
+#endif
+#ifdef ROMWAK_PMULL
+	if(features & CPU_CLMUL){
+		CrcFold = CrcFoldPMULL;
+	}
+#endif
+	(void)features;
+	return CrcFold(data,length,crc,reflected,rem);
+}
+
+long (*CrcFold)(const unsigned char *data, long length, unsigned long crc, int reflected, unsigned char *rem) = CrcFoldDispatch;
+
+/* CpuDispatchAll() - Pick every kernel above now instead of on first use,
+ * where threads would race to do it. main() and the library entry points
+ * call it before starting any; only the first call does the work. */
+#ifdef ROMWAK_POSIX
+static pthread_once_t cpuDispatchOnce = PTHREAD_ONCE_INIT;
+#else
+static bool cpuDispatchDone = false;
+#endif
+
+static void CpuDispatchKernels(void){
+	const unsigned char *in[4] = { NULL, NULL, NULL, NULL };
+
+	DeinterleaveBytes(NULL,NULL,NULL,0);
+	DeinterleaveWords(NULL,NULL,NULL,0);
+	InterleaveBytes(NULL,NULL,NULL,0);
+	InterleaveBytesQuad(in,NULL,0);
+	SwapBytes(NULL,NULL,0,2);
+	CrcFold(NULL,0,0,0,NULL);
+}
+
+void CpuDispatchAll(void){
+#ifdef ROMWAK_POSIX
+	pthread_once(&cpuDispatchOnce,CpuDispatchKernels);
+#else
+	if(!cpuDispatchDone){
+		cpuDispatchDone = true;
+		CpuDispatchKernels();
+	}
+#endif
+}
+/*----------------------------------------------------------------------------*/
+
+/* [Lane Engine]
+ * /b /w /m /q /d and /l /z are all the same transform: N-way interleave or
+ * deinterleave of K-byte lanes. Common (ways,lane) pairs get kernels with
+ * the shape fixed at compile time (vector ones where we have them); any
+ * other shape runs on the generic loop.
+ */
+
+/* LANE_SPLIT(name,N,K) - Kernel moving lane w of every group of N lanes
+ * (K bytes each) to out[w]. count is the number of groups. */
+#define LANE_SPLIT(name,N,K) \
+void name(const unsigned char *in, unsigned char **out, long count){ \
+	long i; \
+	int w; \
+	for(i=0;i<count;i++){ \
+		for(w=0;w<N;w++){ \
+			memcpy(out[w]+i*K,in+(i*N+w)*K,K); \
+		} \
+	} \
+}
+
+/* LANE_MERGE(name,N,K) - Inverse of LANE_SPLIT. */
+#define LANE_MERGE(name,N,K) \
+void name(const unsigned char **in, unsigned char *out, long count){ \
+	long i; \
+	int w; \
+	for(i=0;i<count;i++){ \
+		for(w=0;w<N;w++){ \
+			memcpy(out+(i*N+w)*K,in[w]+i*K,K); \
+		} \
+	} \
+}
+
+LANE_SPLIT(SplitLanes4x1,4,1)
+LANE_SPLIT(SplitLanes4x2,4,2)
+LANE_SPLIT(SplitLanes2x4,2,4)
+LANE_SPLIT(SplitLanes4x4,4,4)
+LANE_MERGE(MergeLanes2x2,2,2)
+LANE_MERGE(MergeLanes4x2,4,2)
+LANE_MERGE(MergeLanes2x4,2,4)
+LANE_MERGE(MergeLanes4x4,4,4)
+
+void SplitLanes2x1(const unsigned char *in, unsigned char **out, long count){
+	DeinterleaveBytes(in,out[0],out[1],count);
+}
+
+void SplitLanes2x2(const unsigned char *in, unsigned char **out, long count){
+	DeinterleaveWords(in,out[0],out[1],count);
+}
+
+void MergeLanes2x1(const unsigned char **in, unsigned char *out, long count){
+	InterleaveBytes(in[0],in[1],out,count);
+}
+
+void MergeLanes4x1(const unsigned char **in, unsigned char *out, long count){
+	InterleaveBytesQuad(in,out,count);
+}
+
+/* Kernels for the shapes known at compile time */
+static const struct {
+	int ways;
+	int lane;
+	LaneSplitFn split;
+	LaneMergeFn merge;
+} laneKernels[] = {
+	{ 2, 1, SplitLanes2x1, MergeLanes2x1 },
+	{ 2, 2, SplitLanes2x2, MergeLanes2x2 },
+	{ 2, 4, SplitLanes2x4, MergeLanes2x4 },
+	{ 4, 1, SplitLanes4x1, MergeLanes4x1 },
+	{ 4, 2, SplitLanes4x2, MergeLanes4x2 },
+	{ 4, 4, SplitLanes4x4, MergeLanes4x4 }
+};
+
+/* LaneFormatInit(LaneFormat *fmt, int ways, int lane)
+ * Describe a lane layout and pick its kernels. Other shapes get NULL
+ * kernels and run on the generic loops.
+ *
+ * (Params)
+ * LaneFormat *fmt		Format to fill in
+ * int ways				Number of split files (2..LANE_MAX_WAYS)
+ * int lane				Bytes per lane (1..LANE_MAX_WIDTH)
+ */
+void LaneFormatInit(LaneFormat *fmt, int ways, int lane){
+	size_t i;
+
+	fmt->ways = ways;
+	fmt->lane = lane;
+	fmt->split = NULL;
+	fmt->merge = NULL;
+	for(i=0;i<sizeof(laneKernels)/sizeof(laneKernels[0]);i++){
+		if(laneKernels[i].ways == ways && laneKernels[i].lane == lane){
+			fmt->split = laneKernels[i].split;
+			fmt->merge = laneKernels[i].merge;
+		}
+	}
+}
+/*----------------------------------------------------------------------------*/
+
+/* SplitLanesKernel - StreamTransform() kernel for LaneSplit, ctx is the LaneFormat. */
+void SplitLanesKernel(const unsigned char **src, unsigned char **dst, long units, const void *ctx){
+	const LaneFormat *fmt = (const LaneFormat*)ctx;
+	long i;
+	int w;
+
+	if(fmt->split != NULL){
+		fmt->split(src[0],dst,units);
+		return;
+	}
+	for(i=0;i<units;i++){
+		for(w=0;w<fmt->ways;w++){
+			memcpy(dst[w]+i*fmt->lane,src[0]+(i*fmt->ways+w)*fmt->lane,fmt->lane);
+		}
+	}
+}
+
+/* MergeLanesKernel - StreamTransform() kernel for LaneMerge, ctx is the LaneFormat. */
+void MergeLanesKernel(const unsigned char **src, unsigned char **dst, long units, const void *ctx){
+	const LaneFormat *fmt = (const LaneFormat*)ctx;
+	long i;
+	int w;
+
+	if(fmt->merge != NULL){
+		fmt->merge(src,dst[0],units);
+		return;
+	}
+	for(i=0;i<units;i++){
+		for(w=0;w<fmt->ways;w++){
+			memcpy(dst[0]+(i*fmt->ways+w)*fmt->lane,src[w]+i*fmt->lane,fmt->lane);
+		}
+	}
+}
+/*----------------------------------------------------------------------------*/
+
+/* StreamSplitLanes(StreamJob *job, const LaneFormat *fmt)
+ * Deinterleave the job's only input into its outputs, one per way. A final
+ * partial group is dealt out the same way: lane by lane, the last one short.
+ * Returns 0 on success.
+ *
+ * (Params)
+ * StreamJob *job		Job with one input and fmt->ways outputs
+ * const LaneFormat *fmt	Lane layout
+ */
+int StreamSplitLanes(StreamJob *job, const LaneFormat *fmt){
+	StreamIn *in = &job->in[0];
+	long group = (long)fmt->ways*fmt->lane;
+	long tail = in->length%group;
+	long n;
+	int w;
+
+	if(StreamTransform(job,group,fmt->lane,in->length/group,SplitLanesKernel,fmt) != 0){
+		return -1;
+	}
+	for(w=0;w<fmt->ways;w++){
+		n = tail < fmt->lane ? tail : fmt->lane;
+		if(StreamCopy(job,in,&job->out[w],n) != 0){
+			return -1;
+		}
+		tail -= n;
+	}
+	return 0;
+}
+/*----------------------------------------------------------------------------*/
+
+/* StreamMergeLanes(StreamJob *job, const LaneFormat *fmt)
+ * Interleave the job's inputs (one per way, all the same size) into its only
+ * output. A final partial lane is taken from each input in turn.
+ * Returns 0 on success.
+ *
+ * (Params)
+ * StreamJob *job		Job with fmt->ways inputs and one output
+ * const LaneFormat *fmt	Lane layout
+ */
+int StreamMergeLanes(StreamJob *job, const LaneFormat *fmt){
+	long tail = job->in[0].length%fmt->lane;
+	int w;
+
+	if(StreamTransform(job,fmt->lane,(long)fmt->ways*fmt->lane,job->in[0].length/fmt->lane,MergeLanesKernel,fmt) != 0){
+		return -1;
+	}
+	for(w=0;w<fmt->ways;w++){
+		if(StreamCopy(job,&job->in[w],&job->out[0],tail) != 0){
+			return -1;
+		}
+	}
+	return 0;
+}
+/*----------------------------------------------------------------------------*/
+
+/* FlipBytesKernel - one element per unit, byte order reversed. ctx points
+ * to the element width in bytes. (/f) */
+void FlipBytesKernel(const unsigned char **src, unsigned char **dst, long units, const void *ctx){
+	SwapBytes(src[0],dst[0],units,*(const int*)ctx);
+}
+/*----------------------------------------------------------------------------*/
+
+/* StreamFlip(StreamJob *job, int size)
+ * Reverse the byte order of every size byte value of the only input into
+ * the only output; trailing bytes that don't make up a value are copied
+ * unchanged. Returns 0 on success. (/f)
+ *
+ * (Params)
+ * StreamJob *job		Job with one input and one output
+ * int size				Bytes per value (2, 4 or 8)
+ */
+int StreamFlip(StreamJob *job, int size){
+	StreamIn *in = &job->in[0];
+
+	if(StreamTransform(job,size,size,in->length/size,FlipBytesKernel,&size) != 0
+	|| StreamCopy(job,in,&job->out[0],in->length%size) != 0){
+		return -1;
+	}
+	return 0;
+}
+/*----------------------------------------------------------------------------*/
+
+/* StreamSplitHalf(StreamJob *job)
+ * First half of the only input to the first output, second half to the
+ * second. An odd last byte is dropped. Returns 0 on success. (/h)
+ *
+ * (Params)
+ * StreamJob *job		Job with one input and two outputs
+ */
+int StreamSplitHalf(StreamJob *job){
+	StreamIn *in = &job->in[0];
+	long halfLength = in->length/2;
+
+	if(StreamCopy(job,in,&job->out[0],halfLength) != 0
+	|| StreamCopy(job,in,&job->out[1],halfLength) != 0){
+		return -1;
+	}
+	return 0;
+}
+/*----------------------------------------------------------------------------*/
+
+/* StreamSwapHalf(StreamJob *job)
+ * Write the second half of the only input, the middle byte (if any), then
+ * the first half. Returns 0 on success. (/s)
+ *
+ * (Params)
+ * StreamJob *job		Job with one input and one output
+ */
+int StreamSwapHalf(StreamJob *job){
+	StreamIn *in = &job->in[0];
+	StreamOut *out = &job->out[0];
+	long halfLength = in->length/2;
+
+	if(StreamSeek(job,in,in->length-halfLength) != 0
+	|| StreamCopy(job,in,out,halfLength) != 0
+	|| StreamSeek(job,in,halfLength) != 0
+	|| StreamCopy(job,in,out,in->length-2*halfLength) != 0
+	|| StreamSeek(job,in,0) != 0
+	|| StreamCopy(job,in,out,halfLength) != 0){
+		return -1;
+	}
+	return 0;
+}
+/*----------------------------------------------------------------------------*/
+
+/* StreamConcat(StreamJob *job, long split)
+ * Copy every input, in order, to the first output until split bytes have
+ * been written, and the rest to the second output. Returns 0 on success.
+ * (/c with a single output, /e splits at 8MB)
+ *
+ * (Params)
+ * StreamJob *job		Job with inputs and one or two outputs
+ * long split			Size of the first output, when there is a second
+ */
+int StreamConcat(StreamJob *job, long split){
+	StreamOut *out = &job->out[0];
+	StreamIn *in;
+	long n;
+	int i;
+
+	for(i=0;i<job->numIn;i++){
+		in = &job->in[i];
+		while(in->pos < in->length){
+			n = in->length-in->pos;
+			if(job->numOut > 1 && out == &job->out[0] && n > split-out->pos){
+				n = split-out->pos;
+			}
+			if(StreamCopy(job,in,out,n) != 0){
+				return -1;
+			}
+			if(job->numOut > 1 && out->pos >= split){
+				out = &job->out[1];
+			}
+		}
+	}
+	return 0;
+}
+/*----------------------------------------------------------------------------*/
+
+/* Names for the ports of the N-way operations, for error messages */
+static const char *inputNames[LANE_MAX_WAYS] = {
+	"first input file", "second input file", "third input file", "fourth input file",
+	"fifth input file", "sixth input file", "seventh input file", "eighth input file"
+};
+static const char *outputNames[LANE_MAX_WAYS] = {
+	"first output file", "second output file", "third output file", "fourth output file",
+	"fifth output file", "sixth output file", "seventh output file", "eighth output file"
+};
+
+/* SplitLanes(char *fileIn, char **fileOut, int ways, int lane)
+ * Helper for the split operations: deinterleave fileIn into ways files.
+ *
+ * (Params)
+ * char *fileIn			Input filename
+ * char **fileOut		Output filenames, one per way
+ * int ways				Number of output files
+ * int lane				Bytes per lane
+ */
+int SplitLanes(char *fileIn, char **fileOut, int ways, int lane){
+	StreamJob job;
+	LaneFormat fmt;
+	int w;
+
+	LaneFormatInit(&fmt,ways,lane);
+	JobInit(&job);
+	if(JobInput(&job,fileIn,"input file") == NULL){
+		return JobFail(&job);
+	}
+	for(w=0;w<ways;w++){
+		if(JobOutput(&job,fileOut[w],outputNames[w]) == NULL){
+			return JobFail(&job);
+		}
+	}
+
+	if(StreamSplitLanes(&job,&fmt) != 0){
+		return JobFail(&job);
+	}
+
+	if(JobClose(&job) != 0){
+		return JobFail(&job);
+	}
+	return EXIT_SUCCESS;
+}
+/*----------------------------------------------------------------------------*/
+
+/* MergeLanes(char **fileIn, int ways, int lane, char *fileOut)
+ * Helper for the merge operations: interleave ways files into fileOut.
+ * The input files must all have the same size.
+ *
+ * (Params)
+ * char **fileIn		Input filenames, one per way
+ * int ways				Number of input files
+ * int lane				Bytes per lane
+ * char *fileOut		Output filename
+ */
+int MergeLanes(char **fileIn, int ways, int lane, char *fileOut){
+	StreamJob job;
+	LaneFormat fmt;
+	int w;
+
+	LaneFormatInit(&fmt,ways,lane);
+	JobInit(&job);
+	for(w=0;w<ways;w++){
+		if(JobInput(&job,fileIn[w],inputNames[w]) == NULL){
+			return JobFail(&job);
+		}
+	}
+	if(!SameLengths(&job)){
+		return EXIT_FAILURE;
+	}
+	if(JobOutput(&job,fileOut,"output file") == NULL){
+		return JobFail(&job);
+	}
+
+	if(StreamMergeLanes(&job,&fmt) != 0){
+		return JobFail(&job);
+	}
+
+	if(JobClose(&job) != 0){
+		return JobFail(&job);
+	}
+	return EXIT_SUCCESS;
+}
+/*----------------------------------------------------------------------------*/
+
+/* ParseLaneFormat(char *ways, char *lane, int *numWays, int *laneSize)
+ * Helper for /l and /z: check the ways and lane parameters.
+ *
+ * (Params)
+ * char *ways			Number of files, as given on the command line
+ * char *lane			Bytes per lane, as given on the command line
+ * int *numWays			Receives the number of files
+ * int *laneSize		Receives the bytes per lane
+ */
+bool ParseLaneFormat(char *ways, char *lane, int *numWays, int *laneSize){
+	if(ways == NULL || lane == NULL){
+		printf("Error need ways and lane parameters\n");
+		return false;
+	}
+	*numWays = atoi(ways);
+	*laneSize = atoi(lane);
+	if(*numWays < 2 || *numWays > LANE_MAX_WAYS){
+		printf("Error ways must be between 2 and %d\n",LANE_MAX_WAYS);
+		return false;
+	}
+	if(*laneSize < 1 || *laneSize > LANE_MAX_WIDTH){
+		printf("Error lane must be between 1 and %d bytes\n",LANE_MAX_WIDTH);
+		return false;
+	}
+	return true;
+}
+/*----------------------------------------------------------------------------*/
+
+/* EqualSplit(char *fileIn, char *fileOutA, char *fileOutB) - /h
+ * Splits a file in half equally.
+ * (Get filesize, divide it by 2, and split the data. Easy enough.)
+ *
+ * (Params)
+ * char *fileIn			Input filename
+ * char *fileOutA		Output filename 1
+ * char *fileOutB		Output filename 2
+ */
+int EqualSplit(char *fileIn, char *fileOutA, char *fileOutB){
+	StreamJob job;
+	StreamIn *in;
+
+	if(!FileExists(fileIn)){
+		return EXIT_FAILURE;
+	}
+	printf("Splitting file '%s' equally, saving to '%s' and '%s'\n",fileIn,fileOutA,fileOutB);
+
+	JobInit(&job);
+	in = JobInput(&job,fileIn,"input file");
+	if(in == NULL
+	|| JobOutput(&job,fileOutA,"first output file") == NULL
+	|| JobOutput(&job,fileOutB,"second output file") == NULL){
+		return JobFail(&job);
+	}
+
+	/* first half goes to file A, second half to file B */
+	if(StreamSplitHalf(&job) != 0){
+		return JobFail(&job);
+	}
+
+	if(JobClose(&job) != 0){
+		return JobFail(&job);
+	}
+	printf("'%s' saved successfully!\n",fileOutA);
+	printf("'%s' saved successfully!\n",fileOutB);
+
+	return EXIT_SUCCESS;
+}
+/*----------------------------------------------------------------------------*/
+
+/* ByteSplit(char *fileIn, char *fileOutA, char *fileOutB) - /b
+ * An odd last byte goes to file A.
+ *
+ * (Params)
+ * char *fileIn			Input filename
+ * char *fileOutA		Output filename 1
+ * char *fileOutB		Output filename 2
+ */
+int ByteSplit(char *fileIn, char *fileOutA, char *fileOutB){
+	char *fileOut[2];
+
+	if(!FileExists(fileIn)){
+		return EXIT_FAILURE;
+	}
+	printf("Splitting file '%s' into bytes, saving to '%s' and '%s'\n",fileIn,fileOutA,fileOutB);
+
+	/* even bytes go to file A, odd bytes to file B */
+	fileOut[0] = fileOutA;
+	fileOut[1] = fileOutB;
+	if(SplitLanes(fileIn,fileOut,2,1) != EXIT_SUCCESS){
+		return EXIT_FAILURE;
+	}
+	printf("'%s' saved successfully!\n",fileOutA);
+	printf("'%s' saved successfully!\n",fileOutB);
+
+	return EXIT_SUCCESS;
+}
+/*----------------------------------------------------------------------------*/
+
+/* WordSplit(char *fileIn, char *fileOutA, char *fileOutB) - /w
+ * A trailing partial group of words is split the same way: its first word
+ * goes to file A and whatever is left to file B.
+ *
+ * (Params)
+ * char *fileIn			Input filename
+ * char *fileOutA		Output filename 1
+ * char *fileOutB		Output filename 2
+ */
+int WordSplit(char *fileIn, char *fileOutA, char *fileOutB){
+	char *fileOut[2];
+
+	if(!FileExists(fileIn)){
+		return EXIT_FAILURE;
+	}
+	printf("Splitting file '%s' into words, saving to '%s' and '%s'\n",fileIn,fileOutA,fileOutB);
+
+	/* even words go to file A, odd words to file B */
+	fileOut[0] = fileOutA;
+	fileOut[1] = fileOutB;
+	if(SplitLanes(fileIn,fileOut,2,2) != EXIT_SUCCESS){
+		return EXIT_FAILURE;
+	}
+	printf("'%s' saved successfully!\n",fileOutA);
+	printf("'%s' saved successfully!\n",fileOutB);
+
+	return EXIT_SUCCESS;
+}
+/*----------------------------------------------------------------------------*/
+
+/* LaneSplit(char *fileIn, char **fileOut, char *ways, char *lane) - /l
+ * Splits a file into ways files, dealing out lanes of lane bytes in turn.
+ * (/b is 2 ways of 1 byte, /w is 2 ways of 2 bytes.)
+ *
+ * (Params)
+ * char *fileIn			Input filename
+ * char **fileOut		Output filenames, one per way
+ * char *ways			Number of output files (2-8)
+ * char *lane			Bytes per lane (1-64)
+ */
+int LaneSplit(char *fileIn, char **fileOut, char *ways, char *lane){
+	int numWays, laneSize;
+	int w;
+
+	if(!ParseLaneFormat(ways,lane,&numWays,&laneSize)){
+		return EXIT_FAILURE;
+	}
+	for(w=0;w<numWays;w++){
+		if(fileOut[w] == NULL){
+			printf("Error %d output files are needed.\n",numWays);
+			return EXIT_FAILURE;
+		}
+	}
+	if(!FileExists(fileIn)){
+		return EXIT_FAILURE;
+	}
+	printf("Splitting file '%s' into %d files by %d byte lanes\n",fileIn,numWays,laneSize);
+
+	if(SplitLanes(fileIn,fileOut,numWays,laneSize) != EXIT_SUCCESS){
+		return EXIT_FAILURE;
+	}
+	for(w=0;w<numWays;w++){
+		printf("'%s' saved successfully!\n",fileOut[w]);
+	}
+
+	return EXIT_SUCCESS;
+}
+/*----------------------------------------------------------------------------*/
+
+/* FlipByte(char *fileIn, char *fileOut, int width) - /f
+ * Flip low/high bytes of a file; /f32 and /f64 reverse the byte order of
+ * 32-bit and 64-bit values instead.
+ * Trailing bytes that don't make up a whole value are copied unchanged.
+ *
+ * (Params)
+ * char *fileIn			Input filename
+ * char *fileOut		Output filename
+ * int width			Bits per value (16, 32 or 64)
+ */
+int FlipByte(char *fileIn, char *fileOut, int width){
+	StreamJob job;
+	StreamIn *in;
+	int size = width/8;
+
+	if(width != 16 && width != 32 && width != 64){
+		printf("Error flip width must be 16, 32 or 64 bits\n");
+		return EXIT_FAILURE;
+	}
+	if(!FileExists(fileIn)){
+		return EXIT_FAILURE;
+	}
+	/* If the second file is not passed in, flip the file in place. */
+	if(fileOut == NULL){
+		fileOut = fileIn;
+	}
+
+	if(width == 16){
+		printf("Flipping bytes of '%s', saving to '%s'\n",fileIn,fileOut);
+	}
+	else{
+		printf("Flipping %d-bit byte order of '%s', saving to '%s'\n",width,fileIn,fileOut);
+	}
+
+	JobInit(&job);
+	in = JobInput(&job,fileIn,"input file");
+	if(in == NULL || JobOutput(&job,fileOut,"output file") == NULL){
+		return JobFail(&job);
+	}
+
+	if(StreamFlip(&job,size) != 0){
+		return JobFail(&job);
+	}
+
+	if(JobClose(&job) != 0){
+		return JobFail(&job);
+	}
+	printf("'%s' saved successfully!\n",fileOut);
+
+	return EXIT_SUCCESS;
+}
+/*----------------------------------------------------------------------------*/
+
+/* SameLengths(StreamJob *job) - Helper for the merge operations.
+ * Byte merging only makes sense for inputs of the same size; reports the
+ * mismatch and closes the job as failed if they differ.
+ *
+ * (Params)
+ * StreamJob *job		Job whose inputs are compared
+ */
+bool SameLengths(StreamJob *job){
+	int i;
+
+	for(i=1;i<job->numIn;i++){
+		if(job->in[i].length != job->in[0].length){
+			printf("Error %s is %ld bytes but %s is %ld bytes; merged files must be the same size.\n",
+				job->in[0].what,job->in[0].length,job->in[i].what,job->in[i].length);
+			/* outputs already attached (a Darksoft set) must not be kept */
+			job->failed = true;
+			JobClose(job);
+			return false;
+		}
+	}
+	return true;
+}
+/*----------------------------------------------------------------------------*/
+
+/* MergeBytes(char *fileIn1, char *fileIn2, char *fileOut) - /m
+ * Byte merges two files; stores result in fileOut.
+ * Both files must have the same size.
+ *
+ * (Params)
+ * char *fileIn1		Input filename 1
+ * char *fileIn2		Input filename 2
+ * char *fileOut		Output filename
+ */
+int MergeBytes(char *fileIn1, char *fileIn2, char *fileOut){
+	char *fileIn[2];
+
+	if(!FileExists(fileIn1)){
+		return EXIT_FAILURE;
+	}
+	if(!FileExists(fileIn2)){
+		return EXIT_FAILURE;
+	}
+
+	printf("Merging bytes of '%s' and '%s', saving to '%s'\n",fileIn1,fileIn2,fileOut);
+
+	fileIn[0] = fileIn1;
+	fileIn[1] = fileIn2;
+	if(MergeLanes(fileIn,2,1,fileOut) != EXIT_SUCCESS){
+		return EXIT_FAILURE;
+	}
+	printf("'%s' saved successfully!\n",fileOut);
+
+	return EXIT_SUCCESS;
+}
+/*----------------------------------------------------------------------------*/
+
+/* MergeBytesQuad(char *fileIn1, char *fileIn2, char *fileIn3, char *fileIn4, char *fileOut) - /q
+ * Byte merges four files; stores result in fileOut.
+ * All four files must have the same size.
+ *
+ * (Params)
+ * char *fileIn1		Input filename 1
+ * char *fileIn2		Input filename 2
+ * char *fileIn3		Input filename 3
+ * char *fileIn4		Input filename 4
+ * char *fileOut		Output filename
+ */
+int MergeBytesQuad(char *fileIn1, char *fileIn2, char *fileIn3, char *fileIn4, char *fileOut){
+	char *fileIn[4];
+
+	if(!FileExists(fileIn1)){
+		return EXIT_FAILURE;
+	}
+	if(!FileExists(fileIn2)){
+		return EXIT_FAILURE;
+	}
+	if(!FileExists(fileIn3)){
+		return EXIT_FAILURE;
+	}
+	if(!FileExists(fileIn4)){
+		return EXIT_FAILURE;
+	}
+
+	printf("Merging bytes of '%s', '%s', '%s', and '%s'; saving to '%s'\n",
+		fileIn1,fileIn2,fileIn3,fileIn4,fileOut
+	);
+
+	fileIn[0] = fileIn1;
+	fileIn[1] = fileIn2;
+	fileIn[2] = fileIn3;
+	fileIn[3] = fileIn4;
+	if(MergeLanes(fileIn,4,1,fileOut) != EXIT_SUCCESS){
+		return EXIT_FAILURE;
+	}
+	printf("'%s' saved successfully!\n",fileOut);
+
+	return EXIT_SUCCESS;
+}
+/*----------------------------------------------------------------------------*/
+
+/* LaneMerge(char **fileIn, char *ways, char *lane) - /z
+ * Merges ways files into one, taking lanes of lane bytes from each in turn.
+ * The last name in fileIn is the output file. All inputs must have the
+ * same size. (/m is 2 ways of 1 byte, /q 4 ways of 1 byte, /d 2 ways of
+ * 2 bytes.)
+ *
+ * (Params)
+ * char **fileIn		Input filenames, one per way, then the output filename
+ * char *ways			Number of input files (2-8)
+ * char *lane			Bytes per lane (1-64)
+ */
+int LaneMerge(char **fileIn, char *ways, char *lane){
+	int numWays, laneSize;
+	char *fileOut;
+	int w;
+
+	if(!ParseLaneFormat(ways,lane,&numWays,&laneSize)){
+		return EXIT_FAILURE;
+	}
+	for(w=0;w<=numWays;w++){
+		if(fileIn[w] == NULL){
+			printf("Error %d input files and an output file are needed.\n",numWays);
+			return EXIT_FAILURE;
+		}
+	}
+	fileOut = fileIn[numWays];
+	for(w=0;w<numWays;w++){
+		if(!FileExists(fileIn[w])){
+			return EXIT_FAILURE;
+		}
+	}
+	printf("Merging %d files by %d byte lanes, saving to '%s'\n",numWays,laneSize,fileOut);
+
+	if(MergeLanes(fileIn,numWays,laneSize,fileOut) != EXIT_SUCCESS){
+		return EXIT_FAILURE;
+	}
+	printf("'%s' saved successfully!\n",fileOut);
+
+	return EXIT_SUCCESS;
+}
+/*----------------------------------------------------------------------------*/
+
+/* ParseLong(const char *text, int base, long *value)
+ * strtol() that accepts only a whole number: no trailing characters and
+ * nothing out of range. Returns true with *value set, or false.
+ */
+bool ParseLong(const char *text, int base, long *value){
+	char *end;
+
+	errno = 0;
+	*value = strtol(text, &end, base);
+	return end != text && *end == '\0' && errno != ERANGE;
+}
+/*----------------------------------------------------------------------------*/
+
+/* UpdateBytes(char *fileIn1, char *fileIn2, char *fileOut, char *updateSize, char *updateOffset) - /u
+ * Byte update two files; stores result in fileOut.
+ * The first updateSize bytes of fileIn1 overwrite fileIn2 at updateOffset.
+ *
+ * fileIn2 is copied whole first, by the kernel where possible (a reflink
+ * costs nothing), then only the patched range is written over it, so the
+ * work done depends on the update size rather than the rom size.
+ *
+ * (Params)
+ * char *fileIn1		Input filename 1 (the patch)
+ * char *fileIn2		Input filename 2 (the file to update)
+ * char *fileOut		Output filename
+ * char *updateSize		Update size
+ * char *updateOffset	Where in fileIn2 the update goes (optional, default 0)
+ */
+int UpdateBytes(char *fileIn1, char *fileIn2, char *fileOut, char *updateSize, char *updateOffset) {
+	StreamJob job;
+	StreamIn *in1, *in2;
+	long size, offset = 0;
+
+	if (updateSize != NULL) {
+		if (!ParseLong(updateSize, 10, &size)) {
+			printf("Error update size '%s' isn't a valid number.\n", updateSize);
+			return EXIT_FAILURE;
+		}
+	}
+	else {
+		perror("Error need size parameter");
+		return EXIT_FAILURE;
+	}
+	if (updateOffset != NULL && !ParseLong(updateOffset, 0, &offset)) {
+		printf("Error update offset '%s' isn't a valid number.\n", updateOffset);
+		return EXIT_FAILURE;
+	}
+	if (size < 0 || offset < 0) {
+		printf("Error update size and offset can't be negative.\n");
+		return EXIT_FAILURE;
+	}
+
+	if (!FileExists(fileIn1)) {
+		return EXIT_FAILURE;
+	}
+	if (!FileExists(fileIn2)) {
+		return EXIT_FAILURE;
+	}
+
+	printf("Updating (%lu)bytes of '%s' to '%s' at offset %lu, saving to '%s'\n",(unsigned long)size, fileIn1, fileIn2, (unsigned long)offset, fileOut);
+
+	JobInit(&job);
+	in1 = JobInput(&job, fileIn1, "first input file");
+	in2 = in1 != NULL ? JobInput(&job, fileIn2, "second input file") : NULL;
+	if (in2 == NULL) {
+		return JobFail(&job);
+	}
+
+	if (size > in1->length) {
+		printf("Error update size larger than file buffer 1.");
+		JobClose(&job);
+		return EXIT_FAILURE;
+	}
+	if (size > LONG_MAX - offset || offset + size > in2->length) {
+		printf("Error update overflow file buffer 2: size and/or offset are out of bounds.");
+		JobClose(&job);
+		return EXIT_FAILURE;
+	}
+
+	if (JobOutput(&job, fileOut, "output file") == NULL) {
+		return JobFail(&job);
+	}
+
+	/* all of file 2, then size bytes of file 1 over it at offset */
+	if (StreamCopy(&job, in2, &job.out[0], in2->length) != 0
+	|| StreamPatch(&job, in1, &job.out[0], offset, size) != 0) {
+		return JobFail(&job);
+	}
+
+	if (JobClose(&job) != 0) {
+		return JobFail(&job);
+	}
+	printf("'%s' saved successfully!\n", fileOut);
+
+	return EXIT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------------*/
+
+/* SwapHalf(char *fileIn, char *fileOut) - /s
+ * Swaps the top and bottom halves of fileIn; writes to fileOut.
+ * With an odd length the middle byte stays where it is.
+ * Without fileOut the result replaces fileIn through a temporary file, so
+ * the original survives a crash; see SwapHalfInPlace() for the variant
+ * that needs no extra disk space.
+ *
+ * (Params)
+ * char *fileIn			Input filename
+ * char *fileOut		Output filename
+ */
+int SwapHalf(char *fileIn, char *fileOut){
+	StreamJob job;
+	StreamIn *in;
+
+	if(!FileExists(fileIn)){
+		return EXIT_FAILURE;
+	}
+	/* If the second file is not passed in, swap the file in place. */
+	if(fileOut == NULL){
+		fileOut = fileIn;
+	}
+
+	printf("Swapping halves of '%s', saving to '%s'\n",fileIn,fileOut);
+
+	JobInit(&job);
+	in = JobInput(&job,fileIn,"input file");
+	if(in == NULL || JobOutput(&job,fileOut,"output file") == NULL){
+		return JobFail(&job);
+	}
+
+	if(StreamSwapHalf(&job) != 0){
+		return JobFail(&job);
+	}
+
+	if(JobClose(&job) != 0){
+		return JobFail(&job);
+	}
+	printf("'%s' saved successfully!\n",fileOut);
+
+	return EXIT_SUCCESS;
+}
+/*----------------------------------------------------------------------------*/
+
+/* FileReadAt(FILE *pFile, unsigned char *data, long n, long offset)
+ * FileWriteAt(FILE *pFile, const unsigned char *data, long n, long offset)
+ * Positioned reads and writes on an open file (pread/pwrite where there
+ * are some). Return 0 on success.
+ */
+static int FileReadAt(FILE *pFile, unsigned char *data, long n, long offset){
+#ifdef ROMWAK_POSIX
+	ssize_t done;
+
+	while(n > 0){
+		done = pread(fileno(pFile),data,(size_t)n,(off_t)offset);
+		if(done <= 0){
+			if(done == 0){
+				errno = EIO; /* file is shorter than expected */
+			}
+			return -1;
+		}
+		data += done;
+		offset += (long)done;
+		n -= (long)done;
+	}
+	return 0;
+#else
+	if(fseek(pFile,offset,SEEK_SET) != 0 || fread(data,1,(size_t)n,pFile) != (size_t)n){
+		return -1;
+	}
+	return 0;
+#endif
+}
+
+static int FileWriteAt(FILE *pFile, const unsigned char *data, long n, long offset){
+#ifdef ROMWAK_POSIX
+	ssize_t done;
+
+	while(n > 0){
+		done = pwrite(fileno(pFile),data,(size_t)n,(off_t)offset);
+		if(done < 0){
+			return -1;
+		}
+		data += done;
+		offset += (long)done;
+		n -= (long)done;
+	}
+	return 0;
+#else
+	if(fseek(pFile,offset,SEEK_SET) != 0 || fwrite(data,1,(size_t)n,pFile) != (size_t)n){
+		return -1;
+	}
+	return 0;
+#endif
+}
+/*----------------------------------------------------------------------------*/
+
+/* SwapHalfInPlace(char *fileIn) - /si
+ * Swaps the halves of fileIn inside the file itself, one chunk of each half
+ * at a time: memory use is fixed and no temporary copy is needed, but a
+ * crash part way leaves the file partly swapped. Running /si again over a
+ * complete swap restores the original. Odd lengths keep the middle byte.
+ *
+ * (Params)
+ * char *fileIn			Input (and output) filename
+ */
+int SwapHalfInPlace(char *fileIn){
+	FILE *pFile;
+	unsigned char *top, *bottom;
+	long length, halfLength, pos, n;
+	const char *error = NULL;
+
+	if(MemFileName(fileIn)){
+		/* in-memory files are replaced in one step anyway */
+		return SwapHalf(fileIn,NULL);
+	}
+	if(!FileExists(fileIn)){
+		return EXIT_FAILURE;
+	}
+	printf("Swapping halves of '%s' in place\n",fileIn);
+
+	pFile = fopen(fileIn,"r+b");
+	if(pFile == NULL){
+		perror("Error attempting to open input file");
+		return EXIT_FAILURE;
+	}
+	length = FileSize(pFile);
+	halfLength = length/2;
+
+	top = (unsigned char*)malloc(STREAM_CHUNK);
+	bottom = (unsigned char*)malloc(STREAM_CHUNK);
+	if(top == NULL || bottom == NULL){
+		error = "Error allocating memory for input file";
+	}
+
+	for(pos=0;pos<halfLength && error == NULL;pos+=n){
+		n = halfLength-pos < STREAM_CHUNK ? halfLength-pos : STREAM_CHUNK;
+		if(FileReadAt(pFile,top,n,pos) != 0
+		|| FileReadAt(pFile,bottom,n,length-halfLength+pos) != 0){
+			error = "Error reading input file";
+		}
+		else if(FileWriteAt(pFile,bottom,n,pos) != 0
+		|| FileWriteAt(pFile,top,n,length-halfLength+pos) != 0){
+			error = "Error writing input file";
+		}
+	}
+
+	free(top);
+	free(bottom);
+	if(fclose(pFile) != 0 && error == NULL){
+		error = "Error writing input file";
+	}
+	if(error != NULL){
+		perror(error);
+		return EXIT_FAILURE;
+	}
+	printf("'%s' saved successfully!\n",fileIn);
+
+	return EXIT_SUCCESS;
+}
+/*----------------------------------------------------------------------------*/
+
+/* PadFile(char *fileIn, char *fileOut, char *padSize, char *padByte) - /p
+ * Pads fileIn to padSize kilobytes with specified padByte; writes to fileOut.
+ * Zero padding takes no disk space where sparse files are supported.
+ *
+ * (Params)
+ * char *fileIn			Input filename
+ * char *fileOut		Output filename
+ * char *padSize		Size to pad file to (in Kilobytes)
+ * char *padByte		Value to pad with (decimal, or hex with 0x)
+ */
+int PadFile(char *fileIn, char *fileOut, char *padSize, char *padByte){
+	long shortPadSize = atol(padSize);
+	long padValue = strtol(padByte,NULL,0);
+	unsigned char padChar = (unsigned char)padValue;
+	StreamJob job;
+	StreamIn *in;
+	long fullPadSize;
+
+	if(shortPadSize < 0 || shortPadSize > LONG_MAX/1024 || padValue < 0 || padValue > 255){
+		printf("Error pad size must be positive and pad byte 0-255\n");
+		return EXIT_FAILURE;
+	}
+	if(!FileExists(fileIn)){
+		return EXIT_FAILURE;
+	}
+
+	printf("Padding '%s' to %ld kilobytes with byte 0x%02X, saving to '%s'\n",
+		fileIn,shortPadSize,padChar,fileOut);
+
+	JobInit(&job);
+	in = JobInput(&job,fileIn,"input file");
+	if(in == NULL){
+		return JobFail(&job);
+	}
+
+	fullPadSize = shortPadSize*1024;
+	if(in->length > fullPadSize){
+		printf("Error '%s' is %ld bytes, already larger than %ld kilobytes\n",fileIn,in->length,shortPadSize);
+		JobClose(&job);
+		return EXIT_FAILURE;
+	}
+	if(JobOutput(&job,fileOut,"output file") == NULL){
+		return JobFail(&job);
+	}
+
+	/* copy the input, then add padding */
+	if(StreamCopy(&job,in,&job.out[0],in->length) != 0
+	|| StreamFill(&job,&job.out[0],padChar,fullPadSize-in->length) != 0){
+		return JobFail(&job);
+	}
+
+	if(JobClose(&job) != 0){
+		return JobFail(&job);
+	}
+	printf("'%s' saved successfully!\n",fileOut);
+
+	return EXIT_SUCCESS;
+}
+/*----------------------------------------------------------------------------*/
+
+/* ConcatFiles(char *fileIn, char *fileOutA, char *fileOutB) - /b
+ *
+ * (Params)
+ * char *fileInA			Input filename 1
+ * char *fileInB			Input filename 2
+ * char *fileOut			Output filename
+ *
+ * OzzyOuzo   note: bored to mess up with system commands thus better to get it included into romwak
+ *			  pretty useful to generate appropriate P roms when using bank switching.
+ */
+
+int ConcatFiles(char *fileInA_, char *fileInB_, char *fileOut_)
+{
+	StreamJob job;
+	StreamIn *inA, *inB;
+
+	if (!FileExists(fileInA_) || !FileExists(fileInB_)) {
+		#ifdef USE_PRINTF_ERRORS
+		printf("Error input file not found\n");
+		#endif
+		return EXIT_FAILURE;
+	}
+
+	JobInit(&job);
+	inA = JobInput(&job, fileInA_, "input file A");
+	inB = inA != NULL ? JobInput(&job, fileInB_, "input file B") : NULL;
+	if (inB == NULL) {
+		return JobFail(&job);
+	}
+
+	if (!inA->length) {
+		errno = 0;
+		JobError(&job, "empty", "file A");
+		return JobFail(&job);
+	}
+	if (!inB->length) {
+		errno = 0;
+		JobError(&job, "empty", "file B");
+		return JobFail(&job);
+	}
+
+	/* create concatened file */
+	if (JobOutput(&job, fileOut_, "output file") == NULL) {
+		return JobFail(&job);
+	}
+
+	if (StreamConcat(&job, 0) != 0) {
+		return JobFail(&job);
+	}
+
+	if (JobClose(&job) != 0) {
+		return JobFail(&job);
+	}
+
+	printf("'%s' + '%s' concatained into '%s' successfully!\n", fileInA_, fileInB_, fileOut_);
+
+	return EXIT_SUCCESS;
+}
+
+/* ConcatFilesEx(char *fileIn, char *fileOutA, char *fileOutB) - /b
+ *
+ * (Params)
+ * char *fileInA			Input filename 1
+ * char *fileInB			Input filename 2
+ * char *pathOut			Output path for generated prom and prom1 files.
+ *
+ * OzzyOuzo   note: Darksoft special concatenation for proms files.
+ *
+ * The concatenation of both files is split at 8MB: the first 8MB go to prom,
+ * everything after that to prom1.
+ */
+
+ /*
+ example for teot:
+
+copy teot-m1.bin p:\foo\darksoft\m1rom
+copy teot-s1.bin p:\foo\darksoft\srom
+romwak /e teot-p1.bin teot-p2.bin p:\foo\darksoft
+romwak /c teot-v1.bin teot-v2.bin p:\foo\darksoft\vroma0
+romwak /d teot-c1.bin teot-c2.bin p:\foo\darksoft\crom0
+
+ as it is using a MiSter core format you'll need to add a text file containing 2 to 3 digits called:fpga
+ into the generated roms directory.
+
+ 1st digit indicates bankswitching mode:
+ ---------------------------------------
+ 0 = no bankswitching
+ 1 = standard bankswitching
+ 2 = neo-pvc bankswitching (F9 & F8)
+ 3 = neo-sma KOF99 bankswitching
+ 4 = neo-sma Garou "KF" version bankswitching
+ 5 = neo-sma Garou "KE" version bankswitching
+ 6 = neo-sma Metal Slug 3 bankswitching
+ 7 = neo-sma KOF2000 bankswitching
+
+ 2nd digit indicates graphics mode:
+ ----------------------------------
+ 0 = CROM full address
+ 1 = CROM zero 1 MSB
+ 2 = CROM zero 2 MSBs
+ 3 = CROM zero 3 MSBs
+ 4 = CROM zero 4 MSBs
+ 5 = NEO-CMC SROM bankswitching (42 version)
+ 6 = NEO-CMC SROM bankswitching (50 version)
+
+ 3rd digit indicates audio mode:
+ -------------------------------
+ 0 = VROM+PCM mode
+ 1 = VROMA/VROMB mode
+
+ generally the value:10 is working fine.
+
+ */
+
+int ConcatFilesEx(char* fileInA_, char* fileInB_, char* pathOut_)
+{
+	StreamJob job;
+	StreamIn* inA, * inB;
+	char fileOut[8192];
+
+	if (!FileExists(fileInA_) || !FileExists(fileInB_)) {
+		#ifdef USE_PRINTF_ERRORS
+		printf("Error input file not found\n");
+		#endif
+		return EXIT_FAILURE;
+	}
+
+	JobInit(&job);
+	inA = JobInput(&job, fileInA_, "input file A");
+	inB = inA != NULL ? JobInput(&job, fileInB_, "input file B") : NULL;
+	if (inB == NULL) {
+		return JobFail(&job);
+	}
+
+	if (!inA->length) {
+		errno = 0;
+		JobError(&job, "empty", "file A");
+		return JobFail(&job);
+	}
+	if (!inB->length) {
+		errno = 0;
+		JobError(&job, "empty", "file B");
+		return JobFail(&job);
+	}
+
+	/* create concatened files */
+
+	sprintf(fileOut, "%s/prom", pathOut_);
+	if (JobOutput(&job, fileOut, "prom file") == NULL) {
+		return JobFail(&job);
+	}
+	/* what doesn't fit in prom goes into prom1 */
+	if (inA->length + inB->length > EIGHT_MB) {
+		sprintf(fileOut, "%s/prom1", pathOut_);
+		if (JobOutput(&job, fileOut, "prom1 file") == NULL) {
+			return JobFail(&job);
+		}
+	}
+
+	/* A, then B, split at 8MB */
+	if (StreamConcat(&job, EIGHT_MB) != 0) {
+		return JobFail(&job);
+	}
+
+	if (JobClose(&job) != 0) {
+		return JobFail(&job);
+	}
+
+	printf("'%s' + '%s' concatained into prom ",fileInA_,fileInB_);
+	if (inA->length + inB->length > EIGHT_MB) {
+		printf("and prom1 ");
+	}
+
+	printf("successfully!\n");
+
+	return EXIT_SUCCESS;
+}
+
+
+/* DarksoftConcatFiles(char *fileIn, char *fileOutA, char *fileOutB) - /b
+ *
+ * (Params)
+ * char *fileInA			Input filename 1
+ * char *fileInB			Input filename 2
+ * char *fileOut			Output filename
+ *
+ * OzzyOuzo   note: Darksoft special word concatenation for croms files.
+ *
+ */
+
+ /*
+ example for cyborgForce:
+
+ copy cyborg-m1.bin p:\foo\Darksoft\cyborgf\m1rom
+ copy cyborg-s1.bin p:\foo\Darksoft\cyborgf\srom
+ romwak /c cyborg-p1.bin cyborg-p2.bin p:\foo\Darksoft\cyborgf\prom
+ romwak /c cyborg-v1.bin cyborg-v2.bin p:\foo\Darksoft\cyborgf\vroma0
+ romwak /d cyborg-c1.bin cyborg-c2.bin p:\foo\Darksoft\cyborgf\crom0
+
+ as it is using a MiSter core format you'll need to add a text file containing 2 to 3 digits called:fpga
+ into the generated roms directory.
+
+ 1st digit indicates bankswitching mode:
+ ---------------------------------------
+ 0 = no bankswitching
+ 1 = standard bankswitching
+ 2 = neo-pvc bankswitching (F9 & F8)
+ 3 = neo-sma KOF99 bankswitching
+ 4 = neo-sma Garou "KF" version bankswitching
+ 5 = neo-sma Garou "KE" version bankswitching
+ 6 = neo-sma Metal Slug 3 bankswitching
+ 7 = neo-sma KOF2000 bankswitching
+
+ 2nd digit indicates graphics mode:
+ ----------------------------------
+ 0 = CROM full address
+ 1 = CROM zero 1 MSB
+ 2 = CROM zero 2 MSBs
+ 3 = CROM zero 3 MSBs
+ 4 = CROM zero 4 MSBs
+ 5 = NEO-CMC SROM bankswitching (42 version)
+ 6 = NEO-CMC SROM bankswitching (50 version)
+
+ 3rd digit indicates audio mode:
+ -------------------------------
+ 0 = VROM+PCM mode
+ 1 = VROMA/VROMB mode
+
+ generally the value:10 is working fine.
+
+ */
+
+int DarksoftConcatFiles(char* fileInA_, char* fileInB_, char* fileOut_)
+{
+	StreamJob job;
+	StreamIn* inA, * inB;
+	LaneFormat fmt;
+
+	if (!FileExists(fileInA_) || !FileExists(fileInB_)) {
+		#ifdef USE_PRINTF_ERRORS
+		printf("Error input file not found\n");
+		#endif
+		return EXIT_FAILURE;
+	}
+
+	JobInit(&job);
+	inA = JobInput(&job, fileInA_, "input file A");
+	inB = inA != NULL ? JobInput(&job, fileInB_, "input file B") : NULL;
+	if (inB == NULL) {
+		return JobFail(&job);
+	}
+
+	if (!inA->length) {
+		errno = 0;
+		JobError(&job, "empty", "file A");
+		return JobFail(&job);
+	}
+	if (!inB->length) {
+		errno = 0;
+		JobError(&job, "empty", "file B");
+		return JobFail(&job);
+	}
+	if (!SameLengths(&job)) {
+		return EXIT_FAILURE;
+	}
+
+	/* create concatened file */
+	if (JobOutput(&job, fileOut_, "output file") == NULL) {
+		return JobFail(&job);
+	}
+
+	/* one word of A, then one word of B */
+	LaneFormatInit(&fmt, 2, 2);
+	if (StreamMergeLanes(&job, &fmt) != 0) {
+		return JobFail(&job);
+	}
+
+	if (JobClose(&job) != 0) {
+		return JobFail(&job);
+	}
+
+	printf("'%s' + '%s' darksoft concataination into '%s' successfully!\n", fileInA_, fileInB_, fileOut_);
+
+	return EXIT_SUCCESS;
+}
+
+
+/*----------------------------------------------------------------------------*/
+
+/* DarksoftSet(char *setDir, char *outDir, char *fpga) - /darksoft
+ * Builds the whole Darksoft/MiSTer layout of a Neo-Geo set in one go, the
+ * steps shown above ConcatFilesEx and DarksoftConcatFiles:
+ *
+ *  prom, prom1	p1, p2.. concatenated, split at 8MB (as /e)
+ *  vroma0		v1, v2.. concatenated (as /c)
+ *  crom0		c1/c2, c3/c4.. word interleaved pairs, one after another (as /d)
+ *  srom, m1rom	copies of s1 and m1
+ *  fpga		the mode digits, "10" unless given
+ *
+ * Roms are found by name: the p/c/v/s/m letter and number right after a '-'
+ * or '_' (or at the start), followed by the extension, e.g. 262-c3.c3 or
+ * teot-p1.bin. The outputs are independent, so each one is built on its own
+ * thread, streaming from the inputs.
+ *
+ * (Params)
+ * char *setDir			Directory holding the set's roms
+ * char *outDir			Output directory (created if missing)
+ * char *fpga			fpga digits, or NULL for "10"
+ */
+#define DARKSOFT_MAX_ROMS	16	/* per letter */
+#define DARKSOFT_PARTS		5
+
+static const char darksoftKinds[] = "pcvsm";
+
+typedef struct {
+	const char *name;		/* output file */
+	int kind;				/* index into darksoftKinds */
+	char **roms;			/* inputs, in order */
+	int numRoms;
+	char *outDir;
+	int status;
+} DarksoftPart;
+
+/* DarksoftRomKind(const char *name, int *number) - Which rom a set file is:
+ * index into darksoftKinds, or -1 for files that aren't roms of the set. */
+static int DarksoftRomKind(const char *name, int *number){
+	const char *kind, *p;
+	int i;
+
+	for(i=0;name[i] != '\0';i++){
+		if(i > 0 && name[i-1] != '-' && name[i-1] != '_'){
+			continue;
+		}
+		kind = strchr(darksoftKinds,name[i]);
+		if(kind == NULL || name[i+1] < '0' || name[i+1] > '9'){
+			continue;
+		}
+		for(p=&name[i+1],*number=0;*p >= '0' && *p <= '9';p++){
+			*number = *number*10+(*p-'0');
+		}
+		if(*p == '.' || *p == '\0'){
+			return (int)(kind-darksoftKinds);
+		}
+	}
+	return -1;
+}
+
+/* DarksoftAdd(char *roms[][DARKSOFT_MAX_ROMS+1], char *setDir, const char *name)
+ * Files one directory entry under its letter and number. Returns false on
+ * a duplicate or out of range rom. */
+static bool DarksoftAdd(char *roms[][DARKSOFT_MAX_ROMS+1], char *setDir, const char *name){
+	int kind, number;
+	char **slot;
+
+	kind = DarksoftRomKind(name,&number);
+	if(kind < 0){
+		return true;
+	}
+	if(number < 1 || number > DARKSOFT_MAX_ROMS){
+		printf("Error '%s' is not a rom number romwak knows (1-%d)\n",name,DARKSOFT_MAX_ROMS);
+		return false;
+	}
+	slot = &roms[kind][number];
+	if(*slot != NULL){
+		printf("Error both '%s' and '%s/%s' look like %c%d\n",*slot,setDir,name,darksoftKinds[kind],number);
+		return false;
+	}
+	*slot = (char*)malloc(strlen(setDir)+strlen(name)+2);
+	if(*slot == NULL){
+		perror("Error allocating memory");
+		return false;
+	}
+	sprintf(*slot,"%s/%s",setDir,name);
+	return true;
+}
+
+/* DarksoftScan(char *setDir, char *roms[][DARKSOFT_MAX_ROMS+1]) - List the
+ * roms of a set directory. Returns false on failure. */
+static bool DarksoftScan(char *setDir, char *roms[][DARKSOFT_MAX_ROMS+1]){
+	bool ok = true;
+#if defined(ROMWAK_POSIX)
+	DIR *dir;
+	struct dirent *entry;
+
+	dir = opendir(setDir);
+	if(dir == NULL){
+		perror("Error attempting to open set directory");
+		return false;
+	}
+	while(ok && (entry = readdir(dir)) != NULL){
+		ok = DarksoftAdd(roms,setDir,entry->d_name);
+	}
+	closedir(dir);
+#elif defined(_WIN32)
+	struct _finddata_t entry;
+	intptr_t handle;
+	char pattern[8192];
+
+	sprintf(pattern,"%s/*",setDir);
+	handle = _findfirst(pattern,&entry);
+	if(handle == -1){
+		perror("Error attempting to open set directory");
+		return false;
+	}
+	do{
+		ok = DarksoftAdd(roms,setDir,entry.name);
+	}while(ok && _findnext(handle,&entry) == 0);
+	_findclose(handle);
+#else
+	(void)roms;
+	printf("Error listing '%s': directories can't be read on this platform\n",setDir);
+	ok = false;
+#endif
+	return ok;
+}
+
+/* DarksoftBuild(DarksoftPart *part) - Write one output of the layout. */
+static int DarksoftBuild(DarksoftPart *part){
+	StreamJob job;
+	StreamIn *in, *inB;
+	StreamOut *out;
+	LaneFormat fmt;
+	char fileOut[8192];
+	long written = 0, n;
+	int i, numOut;
+
+	JobInit(&job);
+	sprintf(fileOut,"%s/%s",part->outDir,part->name);
+	out = JobOutput(&job,fileOut,part->name);
+	if(out == NULL){
+		return JobFail(&job);
+	}
+	LaneFormatInit(&fmt,2,2);
+
+	/* one input (two for crom0) at a time, all into the same output */
+	for(i=0;i<part->numRoms;i++){
+		in = JobInput(&job,part->roms[i],"input file");
+		if(in == NULL){
+			return JobFail(&job);
+		}
+		if(darksoftKinds[part->kind] == 'c'){
+			inB = JobInput(&job,part->roms[++i],"input file");
+			if(inB == NULL){
+				return JobFail(&job);
+			}
+			if(!SameLengths(&job)){
+				return EXIT_FAILURE;
+			}
+			if(StreamMergeLanes(&job,&fmt) != 0){
+				return JobFail(&job);
+			}
+		}
+		else if(darksoftKinds[part->kind] == 'p'){
+			/* the first 8MB go to prom, the rest to prom1 */
+			n = in->length < EIGHT_MB-written ? in->length : EIGHT_MB-written;
+			if(n > 0 && StreamCopy(&job,in,&job.out[0],n) != 0){
+				return JobFail(&job);
+			}
+			written += n;
+			if(in->length > n){
+				if(job.numOut == 1){
+					sprintf(fileOut,"%s/prom1",part->outDir);
+					if(JobOutput(&job,fileOut,"prom1") == NULL){
+						return JobFail(&job);
+					}
+				}
+				if(StreamCopy(&job,in,&job.out[1],in->length-n) != 0){
+					return JobFail(&job);
+				}
+			}
+		}
+		else if(StreamCopy(&job,in,&job.out[0],in->length) != 0){
+			return JobFail(&job);
+		}
+		JobCloseInputs(&job);
+	}
+
+	numOut = job.numOut;
+	if(JobClose(&job) != 0){
+		return JobFail(&job);
+	}
+	printf("'%s/%s'%s built from %d rom%s\n",part->outDir,part->name,
+		numOut > 1 ? " and prom1" : "",part->numRoms,part->numRoms > 1 ? "s" : "");
+	return EXIT_SUCCESS;
+}
+
+#ifdef ROMWAK_POSIX
+typedef struct {
+	DarksoftPart *parts;
+	int numParts;
+	int next;
+	pthread_mutex_t lock;
+} DarksoftQueue;
+
+static void *DarksoftWorker(void *arg){
+	DarksoftQueue *queue = (DarksoftQueue*)arg;
+	int i;
+
+	for(;;){
+		pthread_mutex_lock(&queue->lock);
+		i = queue->next++;
+		pthread_mutex_unlock(&queue->lock);
+		if(i >= queue->numParts){
+			return NULL;
+		}
+		queue->parts[i].status = DarksoftBuild(&queue->parts[i]);
+	}
+}
+#endif
+
+int DarksoftSet(char *setDir, char *outDir, char *fpga){
+	static const char *partNames[DARKSOFT_PARTS] = { "prom", "crom0", "vroma0", "srom", "m1rom" };
+	char *roms[DARKSOFT_PARTS][DARKSOFT_MAX_ROMS+1];	/* by letter, then number (1 based) */
+	DarksoftPart parts[DARKSOFT_PARTS];
+	int numParts = 0, status = EXIT_SUCCESS, kind, i, n;
+	char fileOut[8192];
+	StreamJob job;
+#ifdef ROMWAK_POSIX
+	DarksoftQueue queue;
+	pthread_t tid[DARKSOFT_PARTS];
+	int threads;
+#endif
+
+	if(fpga == NULL){
+		fpga = "10";
+	}
+	n = (int)strlen(fpga);
+	if(n < 2 || n > 3 || strspn(fpga,"0123456789") != (size_t)n){
+		printf("Error fpga mode must be 2 or 3 digits (see readme)\n");
+		return EXIT_FAILURE;
+	}
+
+	printf("Building Darksoft set '%s' from '%s'\n",outDir,setDir);
+	memset(roms,0,sizeof(roms));
+	memset(parts,0,sizeof(parts));
+	if(!DarksoftScan(setDir,roms)){
+		status = EXIT_FAILURE;
+	}
+
+	/* gather each letter's roms in order; numbers must not skip */
+	for(kind=0;kind<DARKSOFT_PARTS && status == EXIT_SUCCESS;kind++){
+		parts[numParts].name = partNames[kind];
+		parts[numParts].kind = kind;
+		parts[numParts].outDir = outDir;
+		parts[numParts].roms = &roms[kind][1];
+		for(n=0;n < DARKSOFT_MAX_ROMS && roms[kind][n+1] != NULL;n++)
+			;
+		for(i=n+1;i<=DARKSOFT_MAX_ROMS;i++){
+			if(roms[kind][i] != NULL){
+				printf("Error '%s' found but %c%d is missing\n",roms[kind][i],darksoftKinds[kind],n+1);
+				status = EXIT_FAILURE;
+			}
+		}
+		if(darksoftKinds[kind] == 's' || darksoftKinds[kind] == 'm'){
+			n = n > 0 ? 1 : 0;	/* only s1 and m1 are copied */
+		}
+		if(darksoftKinds[kind] == 'c' && n % 2 != 0){
+			printf("Error c roms come in pairs, but c%d has no partner\n",n);
+			status = EXIT_FAILURE;
+		}
+		if(n == 0){
+			if(darksoftKinds[kind] == 'p'){
+				printf("Error no p rom found in '%s'\n",setDir);
+				status = EXIT_FAILURE;
+			}
+			else{
+				printf("No %c rom in the set, %s skipped\n",darksoftKinds[kind],partNames[kind]);
+			}
+			continue;
+		}
+		parts[numParts++].numRoms = n;
+	}
+
+	/* in /batch, an @name output directory only exists in memory */
+	if(status == EXIT_SUCCESS && !MemFileName(outDir)){
+#if defined(ROMWAK_POSIX)
+		if(mkdir(outDir,0777) != 0 && errno != EEXIST){
+#elif defined(_WIN32)
+		if(_mkdir(outDir) != 0 && errno != EEXIST){
+#else
+		if(0){
+#endif
+			perror("Error attempting to create output directory");
+			status = EXIT_FAILURE;
+		}
+	}
+
+	if(status == EXIT_SUCCESS){
+		for(i=0;i<numParts;i++){
+			parts[i].status = -1;
+		}
+#ifdef ROMWAK_POSIX
+		memset(&queue,0,sizeof(queue));
+		queue.parts = parts;
+		queue.numParts = numParts;
+		pthread_mutex_init(&queue.lock,NULL);
+		/* the calling thread is one of them */
+		threads = (CpuCount() < numParts ? CpuCount() : numParts)-1;
+		for(i=0;i<threads;i++){
+			if(pthread_create(&tid[i],NULL,DarksoftWorker,&queue) != 0){
+				break;
+			}
+		}
+		threads = i;
+		DarksoftWorker(&queue);
+		for(i=0;i<threads;i++){
+			pthread_join(tid[i],NULL);
+		}
+		pthread_mutex_destroy(&queue.lock);
+#else
+		for(i=0;i<numParts;i++){
+			parts[i].status = DarksoftBuild(&parts[i]);
+		}
+#endif
+		for(i=0;i<numParts;i++){
+			if(parts[i].status != EXIT_SUCCESS){
+				status = EXIT_FAILURE;
+			}
+		}
+	}
+
+	if(status == EXIT_SUCCESS){
+		sprintf(fileOut,"%s/fpga",outDir);
+		JobInit(&job);
+		if(JobOutput(&job,fileOut,"fpga file") == NULL
+		|| StreamWrite(&job,&job.out[0],(const unsigned char*)fpga,strlen(fpga)) != 0
+		|| JobClose(&job) != 0){
+			status = JobFail(&job);
+		}
+	}
+
+	for(kind=0;kind<DARKSOFT_PARTS;kind++){
+		for(i=1;i<=DARKSOFT_MAX_ROMS;i++){
+			free(roms[kind][i]);
+		}
+	}
+	if(status == EXIT_SUCCESS){
+		printf("Darksoft set '%s' built successfully!\n",outDir);
+	}
+	return status;
+}
+
+/*----------------------------------------------------------------------------*/
+
+typedef unsigned short CRC16;
+typedef unsigned long CRC32;
+
+#define POLYNOMIAL 0x04c11db7L
+#define ZIP_POLYNOMIAL 0xedb88320L	/* reflected, for the zip CRC-32 */
+
+/* 32-bit words for the crc tables and digests; keeping table entries this
+ * small lets all eight tables fit in L1 */
+#if UINT_MAX >= 0xffffffffUL
+typedef unsigned int WORD32;
+#else
+typedef unsigned long WORD32;
+#endif
+
+/* crc_table and zip_crc_table: slicing-by-8 tables for both crcs, constant
+ * data generated by gencrc.c ("make crctables") */
+#include "crctables.h"
+
+/* update the CRC on the data block, eight bytes at a time (slicing-by-8) */
+CRC32 update_crc(unsigned long crc_accum, char * data_blk_ptr, int data_blk_size)
+{
+	register const unsigned char	*p = (const unsigned char *)data_blk_ptr;
+	register WORD32				crc = (WORD32)(crc_accum & 0xffffffffL);
+
+	while (data_blk_size >= 8) {
+		crc ^= ((WORD32)p[0] << 24) | ((WORD32)p[1] << 16) | ((WORD32)p[2] << 8) | p[3];
+		crc = crc_table[7][(crc >> 24) & 0xff] ^ crc_table[6][(crc >> 16) & 0xff]
+			^ crc_table[5][(crc >> 8) & 0xff] ^ crc_table[4][crc & 0xff]
+			^ crc_table[3][p[4]] ^ crc_table[2][p[5]]
+			^ crc_table[1][p[6]] ^ crc_table[0][p[7]];
+		p += 8;
+		data_blk_size -= 8;
+	}
+
+	while (data_blk_size-- > 0) {
+		crc = ((crc << 8) & 0xffffffffL) ^ crc_table[0][((crc >> 24) ^ *p++) & 0xff];
+	}
+
+	return crc;
+}
+
+/* update the reflected CRC-32 register (no pre/post inversion), slicing-by-8 */
+CRC32 update_zip_crc(unsigned long crc_accum, char * data_blk_ptr, int data_blk_size)
+{
+	register const unsigned char	*p = (const unsigned char *)data_blk_ptr;
+	register WORD32				crc = (WORD32)(crc_accum & 0xffffffffL);
+
+	while (data_blk_size >= 8) {
+		crc ^= (WORD32)p[0] | ((WORD32)p[1] << 8) | ((WORD32)p[2] << 16) | ((WORD32)p[3] << 24);
+		crc = zip_crc_table[7][crc & 0xff] ^ zip_crc_table[6][(crc >> 8) & 0xff]
+			^ zip_crc_table[5][(crc >> 16) & 0xff] ^ zip_crc_table[4][(crc >> 24) & 0xff]
+			^ zip_crc_table[3][p[4]] ^ zip_crc_table[2][p[5]]
+			^ zip_crc_table[1][p[6]] ^ zip_crc_table[0][p[7]];
+		p += 8;
+		data_blk_size -= 8;
+	}
+
+	while (data_blk_size-- > 0) {
+		crc = ((crc >> 8) & 0xffffffL) ^ zip_crc_table[0][(crc ^ *p++) & 0xff];
+	}
+
+	return crc;
+}
+
+/* fold the bulk of a block with carry-less multiplies when the cpu has them;
+ * the table code finishes the remainder and the tail */
+static CRC32 fold_crc(unsigned long crc_accum, char * p_data, int data_size, int reflected)
+{
+	unsigned char	rem[16];
+	long			used;
+
+	used = CrcFold((const unsigned char *)p_data, data_size, crc_accum & 0xffffffffL, reflected, rem);
+	if (used > 0) {
+		crc_accum = reflected ? update_zip_crc(0, (char *)rem, 16) : update_crc(0, (char *)rem, 16);
+		p_data += used;
+		data_size -= (int)used;
+	}
+	return reflected ? update_zip_crc(crc_accum, p_data, data_size) : update_crc(crc_accum, p_data, data_size);
+}
+
+/* .... */
+CRC32 crc32GenerateKey(unsigned long crc_accum, char * p_data, int data_size)
+{
+	return fold_crc(crc_accum, p_data, data_size, 0);
+}
+
+/* standard (zip) CRC-32; start from 0 and pass the previous result back in */
+CRC32 crc32ZipGenerateKey(unsigned long crc_accum, char * p_data, int data_size)
+{
+	return fold_crc(~crc_accum & 0xffffffffL, p_data, data_size, 1) ^ 0xffffffffL;
+}
+
+/* a * b modulo the crc polynomial, in either bit order */
+static unsigned long crc_multmodp(unsigned long a, unsigned long b, int reflected)
+{
+	unsigned long	prod = 0;
+	int				i;
+
+	for (i = 31; i >= 0; i--) {
+		if (reflected) {
+			/* bit 31 is x^0: walk a from its low power up while b gains powers of x */
+			if (a & (1UL << i))
+				prod ^= b;
+			b = (b & 1) ? (b >> 1) ^ ZIP_POLYNOMIAL : b >> 1;
+		}
+		else {
+			prod = (prod & 0x80000000L) ? ((prod << 1) ^ POLYNOMIAL) & 0xffffffffL : prod << 1;
+			if (b & (1UL << i))
+				prod ^= a;
+		}
+	}
+	return prod;
+}
+
+/* x^(8*length) modulo the crc polynomial */
+static unsigned long crc_xpow8n(unsigned long length, int reflected)
+{
+	unsigned long	result = reflected ? 0x80000000L : 1;
+	unsigned long	power = reflected ? 0x00800000L : 0x100;	/* x^8 */
+
+	while (length != 0) {
+		if (length & 1)
+			result = crc_multmodp(result, power, reflected);
+		power = crc_multmodp(power, power, reflected);
+		length >>= 1;
+	}
+	return result;
+}
+
+/* crc of A followed by B, from crcA = crc of A and crcB = crc of B started
+ * from 0, without touching the data again */
+CRC32 crc32Combine(unsigned long crcA, unsigned long crcB, unsigned long lengthB)
+{
+	return crc_multmodp(crcA, crc_xpow8n(lengthB, 0), 0) ^ crcB;
+}
+
+/* same for crc32ZipGenerateKey results; the inversions cancel out */
+CRC32 crc32ZipCombine(unsigned long crcA, unsigned long crcB, unsigned long lengthB)
+{
+	return crc_multmodp(crcA, crc_xpow8n(lengthB, 1), 1) ^ crcB;
+}
+
+/*----------------------------------------------------------------------------*/
+
+
+/* [Digests]
+ * MD5 (RFC 1321) and SHA-1 (FIPS 180-4) share the 64 byte block buffering
+ * in HashUpdate/HashFinal; they differ only in the block function and in
+ * the byte order of the length and result.
+ */
+
+/* rotate a 32-bit value; WORD32 may be wider, so only the low 32 bits count */
+#define ROTL32(x, n)	((((x) << (n)) | (((x) & 0xffffffffUL) >> (32 - (n)))) & 0xffffffffUL)
+
+typedef struct {
+	WORD32			state[5];
+	WORD32			count[2];	/* bytes hashed, low/high */
+	unsigned char	buf[64];
+	int				used;
+	int				bigEndian;	/* SHA-1 */
+	void			(*block)(WORD32 *state, const unsigned char *p);
+} HashCtx;
+
+#define MD5_F(x, y, z)	((z) ^ ((x) & ((y) ^ (z))))
+#define MD5_G(x, y, z)	((y) ^ ((z) & ((x) ^ (y))))
+#define MD5_H(x, y, z)	((x) ^ (y) ^ (z))
+#define MD5_I(x, y, z)	((y) ^ ((x) | ~(z)))
+#define MD5_STEP(f, a, b, c, d, x, t, s) \
+	(a) += f((b), (c), (d)) + (x) + (t); \
+	(a) = ROTL32((a), (s)) + (b)
+
+static void md5_block(WORD32 *state, const unsigned char *p)
+{
+	WORD32	a = state[0], b = state[1], c = state[2], d = state[3];
+	WORD32	x[16];
+	int		i;
+
+	for (i = 0; i < 16; i++, p += 4)
+		x[i] = (WORD32)p[0] | ((WORD32)p[1] << 8) | ((WORD32)p[2] << 16) | ((WORD32)p[3] << 24);
+
+	MD5_STEP(MD5_F, a, b, c, d, x[0], 0xd76aa478UL, 7);
+	MD5_STEP(MD5_F, d, a, b, c, x[1], 0xe8c7b756UL, 12);
+	MD5_STEP(MD5_F, c, d, a, b, x[2], 0x242070dbUL, 17);
+	MD5_STEP(MD5_F, b, c, d, a, x[3], 0xc1bdceeeUL, 22);
+	MD5_STEP(MD5_F, a, b, c, d, x[4], 0xf57c0fafUL, 7);
+	MD5_STEP(MD5_F, d, a, b, c, x[5], 0x4787c62aUL, 12);
+	MD5_STEP(MD5_F, c, d, a, b, x[6], 0xa8304613UL, 17);
+	MD5_STEP(MD5_F, b, c, d, a, x[7], 0xfd469501UL, 22);
+	MD5_STEP(MD5_F, a, b, c, d, x[8], 0x698098d8UL, 7);
+	MD5_STEP(MD5_F, d, a, b, c, x[9], 0x8b44f7afUL, 12);
+	MD5_STEP(MD5_F, c, d, a, b, x[10], 0xffff5bb1UL, 17);
+	MD5_STEP(MD5_F, b, c, d, a, x[11], 0x895cd7beUL, 22);
+	MD5_STEP(MD5_F, a, b, c, d, x[12], 0x6b901122UL, 7);
+	MD5_STEP(MD5_F, d, a, b, c, x[13], 0xfd987193UL, 12);
+	MD5_STEP(MD5_F, c, d, a, b, x[14], 0xa679438eUL, 17);
+	MD5_STEP(MD5_F, b, c, d, a, x[15], 0x49b40821UL, 22);
+	MD5_STEP(MD5_G, a, b, c, d, x[1], 0xf61e2562UL, 5);
+	MD5_STEP(MD5_G, d, a, b, c, x[6], 0xc040b340UL, 9);
+	MD5_STEP(MD5_G, c, d, a, b, x[11], 0x265e5a51UL, 14);
+	MD5_STEP(MD5_G, b, c, d, a, x[0], 0xe9b6c7aaUL, 20);
+	MD5_STEP(MD5_G, a, b, c, d, x[5], 0xd62f105dUL, 5);
+	MD5_STEP(MD5_G, d, a, b, c, x[10], 0x02441453UL, 9);
+	MD5_STEP(MD5_G, c, d, a, b, x[15], 0xd8a1e681UL, 14);
+	MD5_STEP(MD5_G, b, c, d, a, x[4], 0xe7d3fbc8UL, 20);
+	MD5_STEP(MD5_G, a, b, c, d, x[9], 0x21e1cde6UL, 5);
+	MD5_STEP(MD5_G, d, a, b, c, x[14], 0xc33707d6UL, 9);
+	MD5_STEP(MD5_G, c, d, a, b, x[3], 0xf4d50d87UL, 14);
+	MD5_STEP(MD5_G, b, c, d, a, x[8], 0x455a14edUL, 20);
+	MD5_STEP(MD5_G, a, b, c, d, x[13], 0xa9e3e905UL, 5);
+	MD5_STEP(MD5_G, d, a, b, c, x[2], 0xfcefa3f8UL, 9);
+	MD5_STEP(MD5_G, c, d, a, b, x[7], 0x676f02d9UL, 14);
+	MD5_STEP(MD5_G, b, c, d, a, x[12], 0x8d2a4c8aUL, 20);
+	MD5_STEP(MD5_H, a, b, c, d, x[5], 0xfffa3942UL, 4);
+	MD5_STEP(MD5_H, d, a, b, c, x[8], 0x8771f681UL, 11);
+	MD5_STEP(MD5_H, c, d, a, b, x[11], 0x6d9d6122UL, 16);
+	MD5_STEP(MD5_H, b, c, d, a, x[14], 0xfde5380cUL, 23);
+	MD5_STEP(MD5_H, a, b, c, d, x[1], 0xa4beea44UL, 4);
+	MD5_STEP(MD5_H, d, a, b, c, x[4], 0x4bdecfa9UL, 11);
+	MD5_STEP(MD5_H, c, d, a, b, x[7], 0xf6bb4b60UL, 16);
+	MD5_STEP(MD5_H, b, c, d, a, x[10], 0xbebfbc70UL, 23);
+	MD5_STEP(MD5_H, a, b, c, d, x[13], 0x289b7ec6UL, 4);
+	MD5_STEP(MD5_H, d, a, b, c, x[0], 0xeaa127faUL, 11);
+	MD5_STEP(MD5_H, c, d, a, b, x[3], 0xd4ef3085UL, 16);
+	MD5_STEP(MD5_H, b, c, d, a, x[6], 0x04881d05UL, 23);
+	MD5_STEP(MD5_H, a, b, c, d, x[9], 0xd9d4d039UL, 4);
+	MD5_STEP(MD5_H, d, a, b, c, x[12], 0xe6db99e5UL, 11);
+	MD5_STEP(MD5_H, c, d, a, b, x[15], 0x1fa27cf8UL, 16);
+	MD5_STEP(MD5_H, b, c, d, a, x[2], 0xc4ac5665UL, 23);
+	MD5_STEP(MD5_I, a, b, c, d, x[0], 0xf4292244UL, 6);
+	MD5_STEP(MD5_I, d, a, b, c, x[7], 0x432aff97UL, 10);
+	MD5_STEP(MD5_I, c, d, a, b, x[14], 0xab9423a7UL, 15);
+	MD5_STEP(MD5_I, b, c, d, a, x[5], 0xfc93a039UL, 21);
+	MD5_STEP(MD5_I, a, b, c, d, x[12], 0x655b59c3UL, 6);
+	MD5_STEP(MD5_I, d, a, b, c, x[3], 0x8f0ccc92UL, 10);
+	MD5_STEP(MD5_I, c, d, a, b, x[10], 0xffeff47dUL, 15);
+	MD5_STEP(MD5_I, b, c, d, a, x[1], 0x85845dd1UL, 21);
+	MD5_STEP(MD5_I, a, b, c, d, x[8], 0x6fa87e4fUL, 6);
+	MD5_STEP(MD5_I, d, a, b, c, x[15], 0xfe2ce6e0UL, 10);
+	MD5_STEP(MD5_I, c, d, a, b, x[6], 0xa3014314UL, 15);
+	MD5_STEP(MD5_I, b, c, d, a, x[13], 0x4e0811a1UL, 21);
+	MD5_STEP(MD5_I, a, b, c, d, x[4], 0xf7537e82UL, 6);
+	MD5_STEP(MD5_I, d, a, b, c, x[11], 0xbd3af235UL, 10);
+	MD5_STEP(MD5_I, c, d, a, b, x[2], 0x2ad7d2bbUL, 15);
+	MD5_STEP(MD5_I, b, c, d, a, x[9], 0xeb86d391UL, 21);
+
+	state[0] = (state[0] + a) & 0xffffffffUL;
+	state[1] = (state[1] + b) & 0xffffffffUL;
+	state[2] = (state[2] + c) & 0xffffffffUL;
+	state[3] = (state[3] + d) & 0xffffffffUL;
+}
+
+#define SHA1_F1(x, y, z)	((z) ^ ((x) & ((y) ^ (z))))
+#define SHA1_F2(x, y, z)	((x) ^ (y) ^ (z))
+#define SHA1_F3(x, y, z)	(((x) & (y)) | ((z) & ((x) | (y))))
+/* message schedule kept as a 16 word ring */
+#define SHA1_W(w, i) \
+	((w)[i] = ROTL32((w)[((i) + 13) & 15] ^ (w)[((i) + 8) & 15] ^ (w)[((i) + 2) & 15] ^ (w)[i], 1))
+#define SHA1_STEP(f, a, b, c, d, e, k, w) \
+	(e) += ROTL32((a), 5) + f((b), (c), (d)) + (k) + (w); \
+	(b) = ROTL32((b), 30)
+
+static void sha1_block(WORD32 *state, const unsigned char *p)
+{
+	WORD32	a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+	WORD32	w[16];
+	int		i;
+
+	for (i = 0; i < 16; i++, p += 4)
+		w[i] = ((WORD32)p[0] << 24) | ((WORD32)p[1] << 16) | ((WORD32)p[2] << 8) | (WORD32)p[3];
+
+	SHA1_STEP(SHA1_F1, a, b, c, d, e, 0x5a827999UL, w[0]);
+	SHA1_STEP(SHA1_F1, e, a, b, c, d, 0x5a827999UL, w[1]);
+	SHA1_STEP(SHA1_F1, d, e, a, b, c, 0x5a827999UL, w[2]);
+	SHA1_STEP(SHA1_F1, c, d, e, a, b, 0x5a827999UL, w[3]);
+	SHA1_STEP(SHA1_F1, b, c, d, e, a, 0x5a827999UL, w[4]);
+	SHA1_STEP(SHA1_F1, a, b, c, d, e, 0x5a827999UL, w[5]);
+	SHA1_STEP(SHA1_F1, e, a, b, c, d, 0x5a827999UL, w[6]);
+	SHA1_STEP(SHA1_F1, d, e, a, b, c, 0x5a827999UL, w[7]);
+	SHA1_STEP(SHA1_F1, c, d, e, a, b, 0x5a827999UL, w[8]);
+	SHA1_STEP(SHA1_F1, b, c, d, e, a, 0x5a827999UL, w[9]);
+	SHA1_STEP(SHA1_F1, a, b, c, d, e, 0x5a827999UL, w[10]);
+	SHA1_STEP(SHA1_F1, e, a, b, c, d, 0x5a827999UL, w[11]);
+	SHA1_STEP(SHA1_F1, d, e, a, b, c, 0x5a827999UL, w[12]);
+	SHA1_STEP(SHA1_F1, c, d, e, a, b, 0x5a827999UL, w[13]);
+	SHA1_STEP(SHA1_F1, b, c, d, e, a, 0x5a827999UL, w[14]);
+	SHA1_STEP(SHA1_F1, a, b, c, d, e, 0x5a827999UL, w[15]);
+	SHA1_STEP(SHA1_F1, e, a, b, c, d, 0x5a827999UL, SHA1_W(w, 0));
+	SHA1_STEP(SHA1_F1, d, e, a, b, c, 0x5a827999UL, SHA1_W(w, 1));
+	SHA1_STEP(SHA1_F1, c, d, e, a, b, 0x5a827999UL, SHA1_W(w, 2));
+	SHA1_STEP(SHA1_F1, b, c, d, e, a, 0x5a827999UL, SHA1_W(w, 3));
+	SHA1_STEP(SHA1_F2, a, b, c, d, e, 0x6ed9eba1UL, SHA1_W(w, 4));
+	SHA1_STEP(SHA1_F2, e, a, b, c, d, 0x6ed9eba1UL, SHA1_W(w, 5));
+	SHA1_STEP(SHA1_F2, d, e, a, b, c, 0x6ed9eba1UL, SHA1_W(w, 6));
+	SHA1_STEP(SHA1_F2, c, d, e, a, b, 0x6ed9eba1UL, SHA1_W(w, 7));
+	SHA1_STEP(SHA1_F2, b, c, d, e, a, 0x6ed9eba1UL, SHA1_W(w, 8));
+	SHA1_STEP(SHA1_F2, a, b, c, d, e, 0x6ed9eba1UL, SHA1_W(w, 9));
+	SHA1_STEP(SHA1_F2, e, a, b, c, d, 0x6ed9eba1UL, SHA1_W(w, 10));
+	SHA1_STEP(SHA1_F2, d, e, a, b, c, 0x6ed9eba1UL, SHA1_W(w, 11));
+	SHA1_STEP(SHA1_F2, c, d, e, a, b, 0x6ed9eba1UL, SHA1_W(w, 12));
+	SHA1_STEP(SHA1_F2, b, c, d, e, a, 0x6ed9eba1UL, SHA1_W(w, 13));
+	SHA1_STEP(SHA1_F2, a, b, c, d, e, 0x6ed9eba1UL, SHA1_W(w, 14));
+	SHA1_STEP(SHA1_F2, e, a, b, c, d, 0x6ed9eba1UL, SHA1_W(w, 15));
+	SHA1_STEP(SHA1_F2, d, e, a, b, c, 0x6ed9eba1UL, SHA1_W(w, 0));
+	SHA1_STEP(SHA1_F2, c, d, e, a, b, 0x6ed9eba1UL, SHA1_W(w, 1));
+	SHA1_STEP(SHA1_F2, b, c, d, e, a, 0x6ed9eba1UL, SHA1_W(w, 2));
+	SHA1_STEP(SHA1_F2, a, b, c, d, e, 0x6ed9eba1UL, SHA1_W(w, 3));
+	SHA1_STEP(SHA1_F2, e, a, b, c, d, 0x6ed9eba1UL, SHA1_W(w, 4));
+	SHA1_STEP(SHA1_F2, d, e, a, b, c, 0x6ed9eba1UL, SHA1_W(w, 5));
+	SHA1_STEP(SHA1_F2, c, d, e, a, b, 0x6ed9eba1UL, SHA1_W(w, 6));
+	SHA1_STEP(SHA1_F2, b, c, d, e, a, 0x6ed9eba1UL, SHA1_W(w, 7));
+	SHA1_STEP(SHA1_F3, a, b, c, d, e, 0x8f1bbcdcUL, SHA1_W(w, 8));
+	SHA1_STEP(SHA1_F3, e, a, b, c, d, 0x8f1bbcdcUL, SHA1_W(w, 9));
+	SHA1_STEP(SHA1_F3, d, e, a, b, c, 0x8f1bbcdcUL, SHA1_W(w, 10));
+	SHA1_STEP(SHA1_F3, c, d, e, a, b, 0x8f1bbcdcUL, SHA1_W(w, 11));
+	SHA1_STEP(SHA1_F3, b, c, d, e, a, 0x8f1bbcdcUL, SHA1_W(w, 12));
+	SHA1_STEP(SHA1_F3, a, b, c, d, e, 0x8f1bbcdcUL, SHA1_W(w, 13));
+	SHA1_STEP(SHA1_F3, e, a, b, c, d, 0x8f1bbcdcUL, SHA1_W(w, 14));
+	SHA1_STEP(SHA1_F3, d, e, a, b, c, 0x8f1bbcdcUL, SHA1_W(w, 15));
+	SHA1_STEP(SHA1_F3, c, d, e, a, b, 0x8f1bbcdcUL, SHA1_W(w, 0));
+	SHA1_STEP(SHA1_F3, b, c, d, e, a, 0x8f1bbcdcUL, SHA1_W(w, 1));
+	SHA1_STEP(SHA1_F3, a, b, c, d, e, 0x8f1bbcdcUL, SHA1_W(w, 2));
+	SHA1_STEP(SHA1_F3, e, a, b, c, d, 0x8f1bbcdcUL, SHA1_W(w, 3));
+	SHA1_STEP(SHA1_F3, d, e, a, b, c, 0x8f1bbcdcUL, SHA1_W(w, 4));
+	SHA1_STEP(SHA1_F3, c, d, e, a, b, 0x8f1bbcdcUL, SHA1_W(w, 5));
+	SHA1_STEP(SHA1_F3, b, c, d, e, a, 0x8f1bbcdcUL, SHA1_W(w, 6));
+	SHA1_STEP(SHA1_F3, a, b, c, d, e, 0x8f1bbcdcUL, SHA1_W(w, 7));
+	SHA1_STEP(SHA1_F3, e, a, b, c, d, 0x8f1bbcdcUL, SHA1_W(w, 8));
+	SHA1_STEP(SHA1_F3, d, e, a, b, c, 0x8f1bbcdcUL, SHA1_W(w, 9));
+	SHA1_STEP(SHA1_F3, c, d, e, a, b, 0x8f1bbcdcUL, SHA1_W(w, 10));
+	SHA1_STEP(SHA1_F3, b, c, d, e, a, 0x8f1bbcdcUL, SHA1_W(w, 11));
+	SHA1_STEP(SHA1_F2, a, b, c, d, e, 0xca62c1d6UL, SHA1_W(w, 12));
+	SHA1_STEP(SHA1_F2, e, a, b, c, d, 0xca62c1d6UL, SHA1_W(w, 13));
+	SHA1_STEP(SHA1_F2, d, e, a, b, c, 0xca62c1d6UL, SHA1_W(w, 14));
+	SHA1_STEP(SHA1_F2, c, d, e, a, b, 0xca62c1d6UL, SHA1_W(w, 15));
+	SHA1_STEP(SHA1_F2, b, c, d, e, a, 0xca62c1d6UL, SHA1_W(w, 0));
+	SHA1_STEP(SHA1_F2, a, b, c, d, e, 0xca62c1d6UL, SHA1_W(w, 1));
+	SHA1_STEP(SHA1_F2, e, a, b, c, d, 0xca62c1d6UL, SHA1_W(w, 2));
+	SHA1_STEP(SHA1_F2, d, e, a, b, c, 0xca62c1d6UL, SHA1_W(w, 3));
+	SHA1_STEP(SHA1_F2, c, d, e, a, b, 0xca62c1d6UL, SHA1_W(w, 4));
+	SHA1_STEP(SHA1_F2, b, c, d, e, a, 0xca62c1d6UL, SHA1_W(w, 5));
+	SHA1_STEP(SHA1_F2, a, b, c, d, e, 0xca62c1d6UL, SHA1_W(w, 6));
+	SHA1_STEP(SHA1_F2, e, a, b, c, d, 0xca62c1d6UL, SHA1_W(w, 7));
+	SHA1_STEP(SHA1_F2, d, e, a, b, c, 0xca62c1d6UL, SHA1_W(w, 8));
+	SHA1_STEP(SHA1_F2, c, d, e, a, b, 0xca62c1d6UL, SHA1_W(w, 9));
+	SHA1_STEP(SHA1_F2, b, c, d, e, a, 0xca62c1d6UL, SHA1_W(w, 10));
+	SHA1_STEP(SHA1_F2, a, b, c, d, e, 0xca62c1d6UL, SHA1_W(w, 11));
+	SHA1_STEP(SHA1_F2, e, a, b, c, d, 0xca62c1d6UL, SHA1_W(w, 12));
+	SHA1_STEP(SHA1_F2, d, e, a, b, c, 0xca62c1d6UL, SHA1_W(w, 13));
+	SHA1_STEP(SHA1_F2, c, d, e, a, b, 0xca62c1d6UL, SHA1_W(w, 14));
+	SHA1_STEP(SHA1_F2, b, c, d, e, a, 0xca62c1d6UL, SHA1_W(w, 15));
+
+	state[0] = (state[0] + a) & 0xffffffffUL;
+	state[1] = (state[1] + b) & 0xffffffffUL;
+	state[2] = (state[2] + c) & 0xffffffffUL;
+	state[3] = (state[3] + d) & 0xffffffffUL;
+	state[4] = (state[4] + e) & 0xffffffffUL;
+}
+
+static void HashUpdate(HashCtx *h, const unsigned char *data, long length)
+{
+	long	n;
+
+	if ((h->count[0] = (h->count[0] + (WORD32)length) & 0xffffffffUL) < (WORD32)(length & 0xffffffffUL))
+		h->count[1]++;
+	h->count[1] += (WORD32)((unsigned long)length >> 16 >> 16);
+
+	if (h->used > 0) {
+		n = 64 - h->used < length ? 64 - h->used : length;
+		memcpy(h->buf + h->used, data, (size_t)n);
+		h->used += (int)n;
+		data += n;
+		length -= n;
+		if (h->used < 64)
+			return;
+		h->block(h->state, h->buf);
+		h->used = 0;
+	}
+	for (; length >= 64; data += 64, length -= 64)
+		h->block(h->state, data);
+	memcpy(h->buf, data, (size_t)length);
+	h->used = (int)length;
+}
+
+/* pad, append the bit length and write the state out as size bytes */
+static void HashFinal(HashCtx *h, unsigned char *out, int size)
+{
+	unsigned char	tail[8];
+	WORD32			hi = ((h->count[1] << 3) | (h->count[0] >> 29)) & 0xffffffffUL;
+	WORD32			lo = (h->count[0] << 3) & 0xffffffffUL;
+	int				i;
+
+	for (i = 0; i < 4; i++) {
+		if (h->bigEndian) {
+			tail[i] = (unsigned char)(hi >> (24 - 8 * i));
+			tail[4 + i] = (unsigned char)(lo >> (24 - 8 * i));
+		}
+		else {
+			tail[i] = (unsigned char)(lo >> (8 * i));
+			tail[4 + i] = (unsigned char)(hi >> (8 * i));
+		}
+	}
+
+	h->buf[h->used++] = 0x80;
+	if (h->used > 56) {
+		memset(h->buf + h->used, 0, (size_t)(64 - h->used));
+		h->block(h->state, h->buf);
+		h->used = 0;
+	}
+	memset(h->buf + h->used, 0, (size_t)(56 - h->used));
+	memcpy(h->buf + 56, tail, 8);
+	h->block(h->state, h->buf);
+
+	for (i = 0; i < size; i++)
+		out[i] = (unsigned char)(h->state[i / 4] >> (h->bigEndian ? 24 - 8 * (i % 4) : 8 * (i % 4)));
+}
+
+/* digests /i can produce, in output order */
+#define DIGEST_CRC		0x01	/* romwak crc (POLYNOMIAL, msb first) */
+#define DIGEST_ZIP		0x02	/* CRC-32 as used by zip and MAME dats */
+#define DIGEST_MD5		0x04
+#define DIGEST_SHA1		0x08
+#define DIGEST_KINDS	4
+
+static const char *digestNames[DIGEST_KINDS] = { "crc", "zip", "md5", "sha1" };
+
+typedef struct {
+	int				kind;
+	unsigned long	crc;
+	HashCtx			hash;
+	unsigned char	value[20];
+} DigestRun;
+
+static void DigestInit(DigestRun *run, int kind)
+{
+	static const WORD32 md5Init[4] = { 0x67452301UL, 0xefcdab89UL, 0x98badcfeUL, 0x10325476UL };
+	static const WORD32 sha1Init[5] = { 0x67452301UL, 0xefcdab89UL, 0x98badcfeUL, 0x10325476UL, 0xc3d2e1f0UL };
+
+	memset(run, 0, sizeof(*run));
+	run->kind = kind;
+	if (kind == DIGEST_MD5) {
+		memcpy(run->hash.state, md5Init, sizeof(md5Init));
+		run->hash.block = md5_block;
+	}
+	else if (kind == DIGEST_SHA1) {
+		memcpy(run->hash.state, sha1Init, sizeof(sha1Init));
+		run->hash.block = sha1_block;
+		run->hash.bigEndian = 1;
+	}
+}
+
+static void DigestUpdate(DigestRun *run, const unsigned char *data, long length)
+{
+	switch (run->kind) {
+		case DIGEST_CRC:
+			run->crc = crc32GenerateKey(run->crc, (char*)data, (int)length);
+			break;
+		case DIGEST_ZIP:
+			run->crc = crc32ZipGenerateKey(run->crc, (char*)data, (int)length);
+			break;
+		default:
+			HashUpdate(&run->hash, data, length);
+			break;
+	}
+}
+
+static void DigestFinal(DigestRun *run)
+{
+	if (run->kind == DIGEST_MD5)
+		HashFinal(&run->hash, run->value, 16);
+	else if (run->kind == DIGEST_SHA1)
+		HashFinal(&run->hash, run->value, 20);
+}
+
+#ifdef ROMWAK_POSIX
+/* One thread per extra digest; every thread hashes the same chunk, then
+ * waits for the next one. The chunk stays valid until all are done. */
+typedef struct {
+	DigestRun			*run;
+	const unsigned char	*data;
+	long				length;
+	unsigned long		generation;
+	int					pending;
+	int					quit;
+	pthread_mutex_t		lock;
+	pthread_cond_t		ready;
+	pthread_cond_t		finished;
+} DigestShare;
+
+typedef struct {
+	DigestShare	*share;
+	DigestRun	*run;
+} DigestWorker;
+
+static void *DigestThread(void *arg)
+{
+	DigestWorker	*worker = (DigestWorker*)arg;
+	DigestShare		*share = worker->share;
+	unsigned long	seen = 0;
+
+	pthread_mutex_lock(&share->lock);
+	for (;;) {
+		while (!share->quit && share->generation == seen)
+			pthread_cond_wait(&share->ready, &share->lock);
+		if (share->quit)
+			break;
+		seen = share->generation;
+		pthread_mutex_unlock(&share->lock);
+
+		DigestUpdate(worker->run, share->data, share->length);
+
+		pthread_mutex_lock(&share->lock);
+		if (--share->pending == 0)
+			pthread_cond_signal(&share->finished);
+	}
+	pthread_mutex_unlock(&share->lock);
+	return NULL;
+}
+#endif
+
+/* Mapped files at least this big get their crcs computed in ranges,
+ * one per thread, and merged with crc32Combine. */
+#define CRC_RANGE_MIN		(16L*1024*1024)
+#define CRC_RANGE_THREADS	64
+
+typedef struct {
+	const unsigned char	*data;
+	long				length;
+	DigestRun			runs[2];
+	int					numRuns;
+} CrcRange;
+
+static void CrcRangeRun(CrcRange *range)
+{
+	long	pos, n;
+	int		i;
+
+	/* chunks keep the data in cache while every crc passes over it */
+	for (pos = 0; pos < range->length; pos += n) {
+		n = range->length - pos < STREAM_CHUNK ? range->length - pos : STREAM_CHUNK;
+		for (i = 0; i < range->numRuns; i++)
+			DigestUpdate(&range->runs[i], range->data + pos, n);
+	}
+}
+
+#ifdef ROMWAK_POSIX
+static void *CrcRangeThread(void *arg)
+{
+	CrcRangeRun((CrcRange*)arg);
+	return NULL;
+}
+#endif
+
+/* CrcRanges(const unsigned char *data, long length, DigestRun *runs, int numRuns)
+ * Computes the crc runs (DIGEST_CRC / DIGEST_ZIP) over a whole buffer,
+ * splitting it into one range per cpu. The merged result matches a
+ * serial pass exactly.
+ */
+static void CrcRanges(const unsigned char *data, long length, DigestRun *runs, int numRuns)
+{
+	CrcRange	ranges[CRC_RANGE_THREADS];
+	int			count = CpuCount(), started = 0, i, j;
+	long		step;
+#ifdef ROMWAK_POSIX
+	pthread_t	tid[CRC_RANGE_THREADS];
+#endif
+
+	if (count > CRC_RANGE_THREADS)
+		count = CRC_RANGE_THREADS;
+	else if (count < 1)
+		count = 1;
+	/* ranges start on 64 byte boundaries */
+	step = ((length / count) + 63) & ~63L;
+
+	for (i = 0; i < count; i++) {
+		ranges[i].data = data + i * step;
+		ranges[i].length = i == count - 1 ? length - i * step : step;
+		if (ranges[i].length < 0)
+			ranges[i].length = 0;
+		ranges[i].numRuns = numRuns;
+		for (j = 0; j < numRuns; j++)
+			DigestInit(&ranges[i].runs[j], runs[j].kind);
+	}
+
+#ifdef ROMWAK_POSIX
+	for (started = 1; started < count; started++) {
+		if (pthread_create(&tid[started], NULL, CrcRangeThread, &ranges[started]) != 0)
+			break;
+	}
+#endif
+	/* this thread takes the first range and any that didn't get a thread */
+	CrcRangeRun(&ranges[0]);
+	for (i = started > 0 ? started : 1; i < count; i++)
+		CrcRangeRun(&ranges[i]);
+#ifdef ROMWAK_POSIX
+	for (i = 1; i < started; i++)
+		pthread_join(tid[i], NULL);
+#endif
+
+	for (j = 0; j < numRuns; j++) {
+		runs[j].crc = ranges[0].runs[j].crc;
+		for (i = 1; i < count; i++) {
+			if (runs[j].kind == DIGEST_ZIP)
+				runs[j].crc = crc32ZipCombine(runs[j].crc, ranges[i].runs[j].crc, (unsigned long)ranges[i].length);
+			else
+				runs[j].crc = crc32Combine(runs[j].crc, ranges[i].runs[j].crc, (unsigned long)ranges[i].length);
+		}
+	}
+}
+
+/* DigestStream(StreamJob *job, StreamIn *in, DigestRun *runs, int numRuns)
+ * Reads the rest of in once, feeding every chunk to all runs. With more
+ * than one run, the others hash the chunk on their own threads while
+ * this one does runs[0].
+ */
+static int DigestStream(StreamJob *job, StreamIn *in, DigestRun *runs, int numRuns)
+{
+	const unsigned char	*data;
+	long				remain = in->length - in->pos;
+	size_t				n;
+	int					i, threads = 0, status = 0;
+#ifdef ROMWAK_POSIX
+	DigestShare			share;
+	DigestWorker		workers[DIGEST_KINDS];
+	pthread_t			tid[DIGEST_KINDS];
+
+	memset(&share, 0, sizeof(share));
+	if (numRuns > 1) {
+		pthread_mutex_init(&share.lock, NULL);
+		pthread_cond_init(&share.ready, NULL);
+		pthread_cond_init(&share.finished, NULL);
+		for (i = 1; i < numRuns; i++) {
+			workers[threads].share = &share;
+			workers[threads].run = &runs[i];
+			if (pthread_create(&tid[threads], NULL, DigestThread, &workers[threads]) != 0)
+				break;
+			threads++;
+		}
+	}
+#endif
+
+	while (remain > 0) {
+		n = remain < STREAM_CHUNK ? (size_t)remain : STREAM_CHUNK;
+		if (StreamRead(job, in, n, &data) != 0) {
+			status = -1;
+			break;
+		}
+#ifdef ROMWAK_POSIX
+		if (threads > 0) {
+			pthread_mutex_lock(&share.lock);
+			share.data = data;
+			share.length = (long)n;
+			share.pending = threads;
+			share.generation++;
+			pthread_cond_broadcast(&share.ready);
+			pthread_mutex_unlock(&share.lock);
+		}
+#endif
+		/* runs without a thread of their own are done here */
+		DigestUpdate(&runs[0], data, (long)n);
+		for (i = threads + 1; i < numRuns; i++)
+			DigestUpdate(&runs[i], data, (long)n);
+#ifdef ROMWAK_POSIX
+		if (threads > 0) {
+			pthread_mutex_lock(&share.lock);
+			while (share.pending > 0)
+				pthread_cond_wait(&share.finished, &share.lock);
+			pthread_mutex_unlock(&share.lock);
+		}
+#endif
+		remain -= n;
+	}
+
+#ifdef ROMWAK_POSIX
+	if (numRuns > 1) {
+		pthread_mutex_lock(&share.lock);
+		share.quit = 1;
+		pthread_cond_broadcast(&share.ready);
+		pthread_mutex_unlock(&share.lock);
+		for (i = 0; i < threads; i++)
+			pthread_join(tid[i], NULL);
+		pthread_cond_destroy(&share.finished);
+		pthread_cond_destroy(&share.ready);
+		pthread_mutex_destroy(&share.lock);
+	}
+#endif
+	(void)threads;
+
+	for (i = 0; i < numRuns; i++)
+		DigestFinal(&runs[i]);
+	return status;
+}
+
+/* DigestJob(StreamJob *job, StreamIn *in, int wanted, DigestRun *runs)
+ * Compute the DIGEST_* digests in wanted over all of in, in a single read.
+ * Returns the number of runs filled in, in DIGEST_* order, or -1 on failure.
+ */
+static int DigestJob(StreamJob *job, StreamIn *in, int wanted, DigestRun *runs)
+{
+	int numRuns = 0, numCrcs = 0, j;
+
+	for (j = 0; j < DIGEST_KINDS; j++) {
+		if (wanted & (1 << j)) {
+			DigestInit(&runs[numRuns++], 1 << j);
+		}
+	}
+	/* big mapped files: crcs run over ranges in parallel, the hashes
+	 * (which can't be split) still take one pass */
+	if (in->map != NULL && in->length >= CRC_RANGE_MIN && CpuCount() > 1) {
+		while (numCrcs < numRuns && (runs[numCrcs].kind == DIGEST_CRC || runs[numCrcs].kind == DIGEST_ZIP)) {
+			numCrcs++;
+		}
+		CrcRanges(in->map, in->length, runs, numCrcs);
+	}
+	if (numCrcs < numRuns && DigestStream(job, in, runs + numCrcs, numRuns - numCrcs) != 0) {
+		return -1;
+	}
+	return numRuns;
+}
+
+/*----------------------------------------------------------------------------*/
+
+
+/* InfoFile(char *fileIn, char *fileOut, char **digests, int numDigests) - /i
+ * Computes size and digests of fileIn in a single read; writes them to fileOut.
+ * Without digest names only the romwak crc is computed.
+ *
+ * (Params)
+ * char *fileIn			Input filename
+ * char *fileOut		Output filename (text)
+ * char **digests		Digest names: crc, zip, md5, sha1 or all
+ * int numDigests		Number of digest names
+ */
+int InfoFile(char *fileIn, char *fileOut, char **digests, int numDigests) {
+	StreamJob job;
+	StreamIn *in;
+	StreamOut *out;
+	DigestRun runs[DIGEST_KINDS];
+	long length;
+	int wanted = 0, numRuns, i, j;
+	char hex[41], *text, *end;
+
+	for (i = 0; i < numDigests; i++) {
+		if (strcmp(digests[i], "all") == 0) {
+			wanted |= (1 << DIGEST_KINDS) - 1;
+			continue;
+		}
+		for (j = 0; j < DIGEST_KINDS && strcmp(digests[i], digestNames[j]) != 0; j++)
+			;
+		if (j == DIGEST_KINDS) {
+			printf("Error unknown digest '%s' (crc, zip, md5, sha1 or all)\n", digests[i]);
+			return EXIT_FAILURE;
+		}
+		wanted |= 1 << j;
+	}
+	if (wanted == 0) {
+		wanted = DIGEST_CRC;
+	}
+
+	if (!FileExists(fileIn)) {
+		return EXIT_FAILURE;
+	}
+	printf("Generating file informations of '%s', saving to '%s'\n", fileIn, fileOut);
+
+	JobInit(&job);
+	in = JobInput(&job, fileIn, "input file");
+	if (in == NULL) {
+		return JobFail(&job);
+	}
+	length = in->length;
+
+	numRuns = DigestJob(&job, in, wanted, runs);
+	if (numRuns < 0) {
+		return JobFail(&job);
+	}
+
+	/* a text line with rom size and digest informations, written through
+	 * the job so a batch can keep it in memory as @name */
+	out = JobOutput(&job, fileOut, "output file");
+	if (out == NULL) {
+		return JobFail(&job);
+	}
+	text = (char*)malloc(strlen(fileIn) + 32 + DIGEST_KINDS * 48);
+	if (text == NULL) {
+		JobError(&job, "allocating memory for", "output file");
+		return JobFail(&job);
+	}
+
+	end = text + sprintf(text, "%s size:%lu", fileIn, (unsigned long)length);
+	printf("%s size:%lu", fileIn, (unsigned long)length);
+	for (i = 0; i < numRuns; i++) {
+		switch (runs[i].kind) {
+			case DIGEST_CRC:
+				end += sprintf(end, " crc32:0x%lx", runs[i].crc);
+				printf(" , crc:0x%lx", runs[i].crc);
+				break;
+			case DIGEST_ZIP:
+				end += sprintf(end, " zipcrc32:%08lx", runs[i].crc);
+				printf(" , zipcrc32:%08lx", runs[i].crc);
+				break;
+			default:
+				for (j = 0; j < (runs[i].kind == DIGEST_MD5 ? 16 : 20); j++) {
+					sprintf(hex + 2 * j, "%02x", runs[i].value[j]);
+				}
+				end += sprintf(end, " %s:%s", runs[i].kind == DIGEST_MD5 ? "md5" : "sha1", hex);
+				printf(" , %s:%s", runs[i].kind == DIGEST_MD5 ? "md5" : "sha1", hex);
+				break;
+		}
+	}
+
+	if (StreamWrite(&job, out, (const unsigned char*)text, end - text) != 0) {
+		free(text);
+		return JobFail(&job);
+	}
+	free(text);
+	if (JobClose(&job) != 0) {
+		return JobFail(&job);
+	}
+	printf("'%s' saved successfully!\n", fileOut);
+
+	return EXIT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------------*/
+
+/* [Library]
+ * The libromwak.h entry points: the operations above on descriptors and
+ * buffers, built from the same engine calls the commands use, but quiet.
+ * Nothing here prints; failures come back as ROMWAK_E* codes.
+ */
+
+/* LibPorts(StreamJob *job, RomwakPort *ports, int num, bool output)
+ * Attach the caller's input or output ports to a job.
+ * Returns ROMWAK_OK or an error code. */
+static int LibPorts(StreamJob *job, RomwakPort *ports, int num, bool output){
+	int i;
+
+	if(num < 0 || num > STREAM_MAX_PORTS || (num > 0 && ports == NULL)){
+		return ROMWAK_EARGS;
+	}
+	for(i=0;i<num;i++){
+		if(ports[i].fd < 0 && (ports[i].length < 0 || (ports[i].data == NULL && ports[i].length > 0))){
+			return ROMWAK_EARGS;
+		}
+	}
+	for(i=0;i<num;i++){
+		if(!output){
+			if((ports[i].fd >= 0 ? JobInputFd(job,ports[i].fd,inputNames[i])
+				: JobInputBuffer(job,(const unsigned char*)ports[i].data,ports[i].length,inputNames[i])) == NULL){
+				return job->errorClass == JOB_ERROR_MEMORY ? ROMWAK_ENOMEM : ROMWAK_EREAD;
+			}
+		}
+		else if((ports[i].fd >= 0 ? JobOutputFd(job,ports[i].fd,outputNames[i])
+			: JobOutputBuffer(job,(unsigned char*)ports[i].data,ports[i].length,outputNames[i])) == NULL){
+			return job->errorClass == JOB_ERROR_MEMORY ? ROMWAK_ENOMEM : ROMWAK_EWRITE;
+		}
+	}
+	/* outputs are emptied only once every one of them was accepted */
+	for(i=0;output && i<num;i++){
+		if(ports[i].fd >= 0 && JobOutputTruncate(job,&job->out[i]) != EXIT_SUCCESS){
+			return ROMWAK_EWRITE;
+		}
+	}
+	return ROMWAK_OK;
+}
+
+/* LibStatus(StreamJob *job) - The error code for the step a job failed at. */
+static int LibStatus(StreamJob *job){
+	switch(job->errorClass){
+		case JOB_ERROR_MEMORY:	return ROMWAK_ENOMEM;
+		case JOB_ERROR_READ:	return ROMWAK_EREAD;
+		default:				return ROMWAK_EWRITE;
+	}
+}
+
+/* LibCheck(int op, StreamJob *job, int numOut, long arg1, long arg2)
+ * Parameters and sizes an operation needs, checked against the attached
+ * inputs before any output is touched. Returns ROMWAK_OK or an error code. */
+static int LibCheck(int op, StreamJob *job, int numOut, long arg1, long arg2){
+	int numIn = job->numIn, i;
+
+	switch(op){
+		case ROMWAK_SPLIT_LANES:
+			return numIn == 1 && numOut >= 2 && arg1 >= 1 && arg1 <= LANE_MAX_WIDTH ? ROMWAK_OK : ROMWAK_EARGS;
+		case ROMWAK_MERGE_LANES:
+			if(numIn < 2 || numOut != 1 || arg1 < 1 || arg1 > LANE_MAX_WIDTH){
+				return ROMWAK_EARGS;
+			}
+			for(i=1;i<numIn;i++){
+				if(job->in[i].length != job->in[0].length){
+					return ROMWAK_ESIZE;
+				}
+			}
+			return ROMWAK_OK;
+		case ROMWAK_SPLIT_HALF:
+			return numIn == 1 && numOut == 2 ? ROMWAK_OK : ROMWAK_EARGS;
+		case ROMWAK_FLIP:
+			return numIn == 1 && numOut == 1 && (arg1 == 16 || arg1 == 32 || arg1 == 64) ? ROMWAK_OK : ROMWAK_EARGS;
+		case ROMWAK_SWAP_HALF:
+			return numIn == 1 && numOut == 1 ? ROMWAK_OK : ROMWAK_EARGS;
+		case ROMWAK_CONCAT:
+			return numIn >= 1 && numOut == 1 ? ROMWAK_OK : ROMWAK_EARGS;
+		case ROMWAK_PROM_SPLIT:
+			return numIn >= 1 && numOut == 2 ? ROMWAK_OK : ROMWAK_EARGS;
+		case ROMWAK_PAD:
+			if(numIn != 1 || numOut != 1 || arg1 < 0 || arg2 < 0 || arg2 > 255){
+				return ROMWAK_EARGS;
+			}
+			return job->in[0].length <= arg1 ? ROMWAK_OK : ROMWAK_ESIZE;
+		case ROMWAK_UPDATE:
+			if(numIn != 2 || numOut != 1 || arg1 < 0 || arg2 < 0){
+				return ROMWAK_EARGS;
+			}
+			return arg1 <= job->in[0].length && arg2 <= job->in[1].length-arg1 ? ROMWAK_OK : ROMWAK_ESIZE;
+	}
+	return ROMWAK_EARGS;
+}
+
+/* LibRun(int op, RomwakPort *in, int numIn, RomwakPort *out, int numOut, long arg1, long arg2, bool map)
+ * RomwakRun(), with map false for descriptors that other processes may
+ * truncate under us (/serve): those are read rather than mapped, so a short
+ * file fails the call instead of raising SIGBUS. */
+static int LibRun(int op, RomwakPort *in, int numIn, RomwakPort *out, int numOut, long arg1, long arg2, bool map){
+	StreamJob job;
+	LaneFormat fmt;
+	int status, i;
+
+	CpuDispatchAll();
+	JobInit(&job);
+	job.noMap = !map;
+	status = LibPorts(&job,in,numIn,false);
+	if(status == ROMWAK_OK){
+		status = LibCheck(op,&job,numOut,arg1,arg2);
+	}
+	if(status == ROMWAK_OK){
+		status = LibPorts(&job,out,numOut,true);
+	}
+	if(status != ROMWAK_OK){
+		job.failed = true;
+		JobClose(&job);
+		return status;
+	}
+
+	switch(op){
+		case ROMWAK_SPLIT_LANES:
+			LaneFormatInit(&fmt,numOut,(int)arg1);
+			status = StreamSplitLanes(&job,&fmt);
+			break;
+		case ROMWAK_MERGE_LANES:
+			LaneFormatInit(&fmt,numIn,(int)arg1);
+			status = StreamMergeLanes(&job,&fmt);
+			break;
+		case ROMWAK_SPLIT_HALF:
+			status = StreamSplitHalf(&job);
+			break;
+		case ROMWAK_FLIP:
+			status = StreamFlip(&job,(int)arg1/8);
+			break;
+		case ROMWAK_SWAP_HALF:
+			status = StreamSwapHalf(&job);
+			break;
+		case ROMWAK_CONCAT:
+			status = StreamConcat(&job,0);
+			break;
+		case ROMWAK_PROM_SPLIT:
+			status = StreamConcat(&job,EIGHT_MB);
+			break;
+		case ROMWAK_PAD:
+			status = StreamCopy(&job,&job.in[0],&job.out[0],job.in[0].length) != 0
+				|| StreamFill(&job,&job.out[0],(unsigned char)arg2,arg1-job.in[0].length) != 0 ? -1 : 0;
+			break;
+		case ROMWAK_UPDATE:
+			status = StreamCopy(&job,&job.in[1],&job.out[0],job.in[1].length) != 0
+				|| StreamPatch(&job,&job.in[0],&job.out[0],arg2,arg1) != 0 ? -1 : 0;
+			break;
+	}
+	if(status != 0){
+		status = LibStatus(&job);
+		job.failed = true;
+		JobClose(&job);
+		return status;
+	}
+
+	for(i=0;i<numOut;i++){
+		if(out[i].fd < 0){
+			out[i].length = job.out[i].pos;
+		}
+	}
+	return JobClose(&job) != 0 ? LibStatus(&job) : ROMWAK_OK;
+}
+/*----------------------------------------------------------------------------*/
+
+int RomwakRun(int op, RomwakPort *in, int numIn, RomwakPort *out, int numOut, long arg1, long arg2){
+	return LibRun(op,in,numIn,out,numOut,arg1,arg2,true);
+}
+/*----------------------------------------------------------------------------*/
+
+/* LibDigest(RomwakPort *in, int digests, RomwakDigests *result, bool map)
+ * RomwakDigest(), with map as for LibRun(). */
+static int LibDigest(RomwakPort *in, int digests, RomwakDigests *result, bool map){
+	StreamJob job;
+	DigestRun runs[DIGEST_KINDS];
+	int status, numRuns, i;
+
+	if(result == NULL || digests & ~((1 << DIGEST_KINDS)-1)){
+		return ROMWAK_EARGS;
+	}
+	memset(result,0,sizeof(RomwakDigests));
+	CpuDispatchAll();
+	JobInit(&job);
+	job.noMap = !map;
+	status = LibPorts(&job,in,1,false);
+	if(status != ROMWAK_OK){
+		JobClose(&job);
+		return status;
+	}
+
+	numRuns = DigestJob(&job,&job.in[0],digests,runs);
+	if(numRuns < 0){
+		status = LibStatus(&job);
+		JobClose(&job);
+		return status;
+	}
+	result->length = job.in[0].length;
+	for(i=0;i<numRuns;i++){
+		switch(runs[i].kind){
+			case DIGEST_CRC: result->crc = runs[i].crc; break;
+			case DIGEST_ZIP: result->zip = runs[i].crc; break;
+			case DIGEST_MD5: memcpy(result->md5,runs[i].value,16); break;
+			case DIGEST_SHA1: memcpy(result->sha1,runs[i].value,20); break;
+		}
+	}
+	JobClose(&job);
+	return ROMWAK_OK;
+}
+/*----------------------------------------------------------------------------*/
+
+int RomwakDigest(RomwakPort *in, int digests, RomwakDigests *result){
+	return LibDigest(in,digests,result,true);
+}
+/*----------------------------------------------------------------------------*/
+
+void RomwakThreads(int threads){
+	CpuCountSet(threads);
+}
+
+const char *RomwakError(int code){
+	switch(code){
+		case ROMWAK_OK:		return "success";
+		case ROMWAK_EARGS:	return "bad operation, parameters or ports";
+		case ROMWAK_ESIZE:	return "input sizes don't suit the operation";
+		case ROMWAK_ENOMEM:	return "out of memory";
+		case ROMWAK_EREAD:	return "error reading input";
+		case ROMWAK_EWRITE:	return "error writing output";
+	}
+	return "unknown error";
+}
+/*----------------------------------------------------------------------------*/
+/* [Batch Mode]
+ * /batch runs a manifest of commands, one per line in the same syntax as
+ * the command line, on a pool of worker threads. A command waits for every
+ * earlier one that writes a file it reads or writes (or that reads a file
+ * it writes); everything else may overlap. Files named "@name" are kept in
+ * memory for as long as a later command still reads them.
+ */
+
+/* least argc of each command (counting "romwak" and the option); commands
+ * with several letters are matched by their full name, the others by their
+ * first letter, like RunCommand's switch */
+static const struct {
+	const char *name;
+	int argc;
+} commandArgs[] = {
+	{ "darksoft", 4 }, { "batch", 3 }, { "serve", 3 },
+	{ "b", 5 }, { "c", 5 }, { "d", 5 }, { "e", 5 }, { "f", 3 }, { "h", 5 },
+	{ "i", 4 }, { "l", 5 }, { "m", 5 }, { "p", 6 }, { "q", 7 }, { "s", 3 },
+	{ "u", 6 }, { "w", 5 }, { "z", 4 }
+};
+
+/* CommandArgs(char *option) - The least argc the command option takes,
+ * 0 for unknown commands. */
+static int CommandArgs(char *option){
+	int i, n = (int)(sizeof(commandArgs)/sizeof(commandArgs[0]));
+
+	if(option[0] != '/' && option[0] != '-'){
+		return 0;
+	}
+	for(i=0;i<n;i++){
+		if(strlen(commandArgs[i].name) > 1 && strcmp(option+1,commandArgs[i].name) == 0){
+			return commandArgs[i].argc;
+		}
+	}
+	for(i=0;i<n;i++){
+		if(strlen(commandArgs[i].name) == 1 && option[1] == commandArgs[i].name[0]){
+			return commandArgs[i].argc;
+		}
+	}
+	return 0;
+}
+
+/* CommandFiles(int argc, char **argv, char **reads, int *numReads, char **writes, int *numWrites)
+ * Lists the files a command reads and writes, mirroring RunCommand's switch.
+ * Unknown commands list nothing; they fail on their own when run.
+ */
+static void CommandFiles(int argc, char **argv, char **reads, int *numReads, char **writes, int *numWrites){
+	int i, first = 2, last = 2, out = 3;
+
+	*numReads = *numWrites = 0;
+	if(argc < 2 || argc < CommandArgs(argv[1])){
+		return;
+	}
+	if(strcmp(&argv[1][1],"darksoft") == 0){
+		/* a whole directory in, a whole directory out */
+		if(argc > 3){
+			reads[(*numReads)++] = argv[2];
+			writes[(*numWrites)++] = argv[3];
+		}
+		return;
+	}
+	switch(argv[1][1]){
+		case 'c': case 'd': case 'e': case 'm': case 'u':
+			last = 3; out = 4;
+			break;
+		case 'q':
+			last = 5; out = 6;
+			break;
+		case 'f': case 's':
+			/* in place when <outfile> is left out */
+			if(argc <= 3){
+				out = 2;
+			}
+			break;
+		case 'l':
+			first = last = 4; out = 5;
+			break;
+		case 'z':
+			first = 4; last = argc - 2; out = argc - 1;
+			break;
+		case 'b': case 'h': case 'i': case 'p': case 'w':
+			break;
+		default:
+			return;
+	}
+
+	for(i=first;i<=last && i<argc;i++){
+		reads[(*numReads)++] = argv[i];
+	}
+	switch(argv[1][1]){
+		case 'b': case 'h': case 'w': case 'l':
+			/* every remaining argument is an output file */
+			for(i=out;i<argc;i++){
+				writes[(*numWrites)++] = argv[i];
+			}
+			break;
+		default:
+			if(out < argc){
+				writes[(*numWrites)++] = argv[out];
+			}
+			break;
+	}
+}
+
+/* SamePath(char *a, char *b) - Equal paths, or one is a directory holding
+ * the other (/e writes <outpath>/prom). */
+static bool SamePath(char *a, char *b){
+	size_t la = strlen(a), lb = strlen(b);
+
+	if(la > lb){
+		char *t = a; a = b; b = t;
+		la = lb;
+	}
+	return strncmp(a,b,la) == 0 && (b[la] == '\0' || b[la] == '/' || b[la] == '\\');
+}
+
+#define BATCH_MAX_ARGS	64
+#define BATCH_LINE		8192
+
+enum { BATCH_WAITING, BATCH_RUNNING, BATCH_DONE, BATCH_FAILED, BATCH_SKIPPED };
+
+typedef struct {
+	int line;
+	char *text;					/* the line as written, for the report */
+	char *args;					/* tokens, split in place */
+	int argc;
+	char *argv[BATCH_MAX_ARGS+4];	/* NULL padded like a real argv */
+	int *deps;					/* earlier jobs to wait for */
+	int numDeps;
+	int state;
+	int status;
+} BatchJob;
+
+typedef struct {
+	BatchJob *jobs;
+	int numJobs;
+	int next;					/* lowest job not yet started */
+#ifdef ROMWAK_POSIX
+	pthread_mutex_t lock;
+	pthread_cond_t changed;
+#endif
+} BatchQueue;
+
+/* BatchParse(BatchJob *job, char *line) - Splits a manifest line into
+ * arguments; double quotes group words. Returns the argument count. */
+static int BatchParse(BatchJob *job, char *line){
+	char *src = line, *dst;
+
+	job->argc = 0;
+	job->argv[job->argc++] = "romwak";
+	dst = job->args = line;
+	while(*src != '\0'){
+		while(*src == ' ' || *src == '\t' || *src == '\r' || *src == '\n'){
+			src++;
+		}
+		if(*src == '\0' || *src == '#'){
+			break;
+		}
+		if(job->argc == BATCH_MAX_ARGS){
+			return -1;
+		}
+		job->argv[job->argc++] = dst;
+		while(*src != '\0' && *src != ' ' && *src != '\t' && *src != '\r' && *src != '\n'){
+			if(*src == '"'){
+				for(src++;*src != '\0' && *src != '"';){
+					*dst++ = *src++;
+				}
+				if(*src == '"'){
+					src++;
+				}
+			}
+			else{
+				*dst++ = *src++;
+			}
+		}
+		if(*src != '\0'){
+			src++;
+		}
+		*dst++ = '\0';
+	}
+	return job->argc;
+}
+
+/* BatchReady(BatchQueue *queue, BatchJob *job) - Decides whether a waiting
+ * job can start: 1 ready, 0 not yet, -1 a job it depends on failed. */
+static int BatchReady(BatchQueue *queue, BatchJob *job){
+	int i, state, ready = 1;
+
+	for(i=0;i<job->numDeps;i++){
+		state = queue->jobs[job->deps[i]].state;
+		if(state == BATCH_FAILED || state == BATCH_SKIPPED){
+			return -1;
+		}
+		if(state != BATCH_DONE){
+			ready = 0;
+		}
+	}
+	return ready;
+}
+
+/* BatchTake(BatchQueue *queue) - Claims the first job that can run, marking
+ * jobs behind failed dependencies as skipped. Called with the lock held.
+ * Returns NULL when nothing can start yet; sets *finished when nothing is
+ * left at all. */
+static BatchJob *BatchTake(BatchQueue *queue, bool *finished){
+	BatchJob *job;
+	int i, ready;
+
+	*finished = true;
+	for(i=queue->next;i<queue->numJobs;i++){
+		job = &queue->jobs[i];
+		if(job->state == BATCH_WAITING){
+			ready = BatchReady(queue,job);
+			if(ready < 0){
+				job->state = BATCH_SKIPPED;
+				continue;
+			}
+			*finished = false;
+			if(ready > 0){
+				job->state = BATCH_RUNNING;
+				return job;
+			}
+		}
+		else if(job->state == BATCH_RUNNING){
+			*finished = false;
+		}
+		if(i == queue->next && job->state != BATCH_WAITING && job->state != BATCH_RUNNING){
+			queue->next++;
+		}
+	}
+	return NULL;
+}
+
+/* BatchRelease(BatchQueue *queue, BatchJob *job) - Once a job is over, drop
+ * the in-memory files it used that no unfinished job is going to read.
+ * Called with the lock held. */
+static void BatchRelease(BatchQueue *queue, BatchJob *job){
+	char *files[BATCH_MAX_ARGS*2], *reads[BATCH_MAX_ARGS], *writes[BATCH_MAX_ARGS];
+	int numFiles, numReads, numWrites, i, j, k;
+	bool needed;
+	BatchJob *other;
+
+	CommandFiles(job->argc,job->argv,files,&numReads,files+BATCH_MAX_ARGS,&numWrites);
+	memmove(files+numReads,files+BATCH_MAX_ARGS,numWrites*sizeof(char*));
+	numFiles = numReads+numWrites;
+
+	for(i=0;i<numFiles;i++){
+		if(!MemFileName(files[i])){
+			continue;
+		}
+		needed = false;
+		for(j=queue->next;j<queue->numJobs && !needed;j++){
+			other = &queue->jobs[j];
+			if(other->state != BATCH_WAITING && other->state != BATCH_RUNNING){
+				continue;
+			}
+			CommandFiles(other->argc,other->argv,reads,&numReads,writes,&numWrites);
+			for(k=0;k<numReads && !needed;k++){
+				needed = SamePath(files[i],reads[k]);
+			}
+		}
+		if(!needed){
+			MemFileDrop(files[i]);
+		}
+	}
+}
+
+static void BatchRun(BatchJob *job){
+	job->status = RunCommand(job->argc,job->argv);
+	printf("\n");
+	fflush(stdout);
+}
+
+#ifdef ROMWAK_POSIX
+static void *BatchWorker(void *arg){
+	BatchQueue *queue = (BatchQueue*)arg;
+	BatchJob *job;
+	bool finished;
+
+	pthread_mutex_lock(&queue->lock);
+	for(;;){
+		job = BatchTake(queue,&finished);
+		if(job == NULL){
+			if(finished){
+				break;
+			}
+			pthread_cond_wait(&queue->changed,&queue->lock);
+			continue;
+		}
+		pthread_mutex_unlock(&queue->lock);
+
+		BatchRun(job);
+
+		pthread_mutex_lock(&queue->lock);
+		job->state = job->status == EXIT_SUCCESS ? BATCH_DONE : BATCH_FAILED;
+		BatchRelease(queue,job);
+		pthread_cond_broadcast(&queue->changed);
+	}
+	/* wake the others so they notice there is nothing left */
+	pthread_cond_broadcast(&queue->changed);
+	pthread_mutex_unlock(&queue->lock);
+	return NULL;
+}
+#endif
+
+/* BatchFile(char *fileIn) - /batch
+ * Runs every command listed in a manifest, then reports each one's status.
+ *
+ * (Params)
+ * char *fileIn			Manifest filename
+ */
+int BatchFile(char *fileIn){
+	FILE *pManifest;
+	BatchQueue queue;
+	BatchJob *job, *prev;
+	char line[BATCH_LINE];
+	char *reads[BATCH_MAX_ARGS], *writes[BATCH_MAX_ARGS];
+	char *prevReads[BATCH_MAX_ARGS], *prevWrites[BATCH_MAX_ARGS];
+	int numReads, numWrites, numPrevReads, numPrevWrites;
+	int lineNo = 0, capacity = 0, failed = 0, threads, i, j, a, b;
+	bool conflict, finished;
+	static const char *stateNames[] = { "not run", "running", "ok", "FAILED", "skipped (an earlier job failed)" };
+#ifdef ROMWAK_POSIX
+	pthread_t tid[64];
+#endif
+
+	if(!FileExists(fileIn)){
+		return EXIT_FAILURE;
+	}
+	pManifest = fopen(fileIn,"r");
+	if(pManifest == NULL){
+		perror("Error attempting to open manifest");
+		return EXIT_FAILURE;
+	}
+
+	memset(&queue,0,sizeof(queue));
+	while(fgets(line,sizeof(line),pManifest) != NULL){
+		lineNo++;
+		if(queue.numJobs == capacity){
+			capacity = capacity ? capacity*2 : 64;
+			job = (BatchJob*)realloc(queue.jobs,capacity*sizeof(BatchJob));
+			if(job == NULL){
+				perror("Error allocating batch jobs");
+				fclose(pManifest);
+				return EXIT_FAILURE;
+			}
+			queue.jobs = job;
+		}
+		job = &queue.jobs[queue.numJobs];
+		memset(job,0,sizeof(*job));
+		job->line = lineNo;
+		job->text = (char*)malloc(strlen(line)*2+2);
+		if(job->text == NULL){
+			perror("Error allocating batch jobs");
+			fclose(pManifest);
+			return EXIT_FAILURE;
+		}
+		strcpy(job->text,line);
+		job->text[strcspn(job->text,"\r\n")] = '\0';
+		/* tokens go in the second half of the same allocation */
+		strcpy(job->text+strlen(line)+1,line);
+		i = BatchParse(job,job->text+strlen(line)+1);
+		if(i < 0){
+			printf("ERROR: %s line %d has more than %d arguments\n",fileIn,lineNo,BATCH_MAX_ARGS-1);
+			fclose(pManifest);
+			return EXIT_FAILURE;
+		}
+		if(i > 1 && (strcmp(job->argv[1]+1,"batch") == 0 || strcmp(job->argv[1]+1,"serve") == 0)){
+			printf("ERROR: %s line %d: %s can't run in a batch\n",fileIn,lineNo,job->argv[1]);
+			fclose(pManifest);
+			return EXIT_FAILURE;
+		}
+		if(i > 1 && i < CommandArgs(job->argv[1])){
+			/* fails on its own, without holding up the rest */
+			printf("ERROR: %s line %d: too few arguments for %s\n",fileIn,lineNo,job->argv[1]);
+			job->state = BATCH_FAILED;
+		}
+		if(i > 1){
+			queue.numJobs++;
+		}
+		else{
+			free(job->text);
+		}
+	}
+	fclose(pManifest);
+
+	/* dependencies: earlier jobs touching a file this one writes, or
+	 * writing a file this one reads */
+	for(i=0;i<queue.numJobs;i++){
+		job = &queue.jobs[i];
+		CommandFiles(job->argc,job->argv,reads,&numReads,writes,&numWrites);
+		job->deps = (int*)malloc((i+1)*sizeof(int));
+		if(job->deps == NULL){
+			perror("Error allocating batch jobs");
+			return EXIT_FAILURE;
+		}
+		for(j=0;j<i;j++){
+			prev = &queue.jobs[j];
+			CommandFiles(prev->argc,prev->argv,prevReads,&numPrevReads,prevWrites,&numPrevWrites);
+			conflict = false;
+			for(a=0;a<numWrites && !conflict;a++){
+				for(b=0;b<numPrevReads && !conflict;b++){
+					conflict = SamePath(writes[a],prevReads[b]);
+				}
+				for(b=0;b<numPrevWrites && !conflict;b++){
+					conflict = SamePath(writes[a],prevWrites[b]);
+				}
+			}
+			for(a=0;a<numReads && !conflict;a++){
+				for(b=0;b<numPrevWrites && !conflict;b++){
+					conflict = SamePath(reads[a],prevWrites[b]);
+				}
+			}
+			if(conflict){
+				job->deps[job->numDeps++] = j;
+			}
+		}
+	}
+
+	printf("Running %d jobs from '%s'\n\n",queue.numJobs,fileIn);
+	fflush(stdout);
+
+	/* shared state the commands set up lazily, done once up front */
+	MemFileEnable(true);
+
+	threads = CpuCount();
+	if(threads > queue.numJobs){
+		threads = queue.numJobs;
+	}
+#ifdef ROMWAK_POSIX
+	if(threads > (int)(sizeof(tid)/sizeof(tid[0]))){
+		threads = (int)(sizeof(tid)/sizeof(tid[0]));
+	}
+	if(threads > 1){
+		pthread_mutex_init(&queue.lock,NULL);
+		pthread_cond_init(&queue.changed,NULL);
+		for(i=0;i<threads;i++){
+			if(pthread_create(&tid[i],NULL,BatchWorker,&queue) != 0){
+				break;
+			}
+		}
+		threads = i;
+		/* with no thread started the loop below does the work */
+		for(i=0;i<threads;i++){
+			pthread_join(tid[i],NULL);
+		}
+		pthread_cond_destroy(&queue.changed);
+		pthread_mutex_destroy(&queue.lock);
+	}
+#endif
+	while((job = BatchTake(&queue,&finished)) != NULL){
+		BatchRun(job);
+		job->state = job->status == EXIT_SUCCESS ? BATCH_DONE : BATCH_FAILED;
+		BatchRelease(&queue,job);
+	}
+	MemFileEnable(false);
+
+	printf("Batch '%s' results:\n",fileIn);
+	for(i=0;i<queue.numJobs;i++){
+		job = &queue.jobs[i];
+		if(job->state != BATCH_DONE){
+			failed++;
+		}
+		printf(" line %d: %s: %s\n",job->line,job->text,stateNames[job->state]);
+		free(job->deps);
+		free(job->text);
+	}
+	free(queue.jobs);
+	printf("%d of %d jobs succeeded.\n",queue.numJobs-failed,queue.numJobs);
+
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------------*/
+
+/* [Serve Mode]
+ * /serve keeps one process running for callers that would otherwise start
+ * romwak for every operation. Requests arrive on a Unix stream socket as a
+ * RomwakRequest (libromwak.h) with the input and output descriptors passed
+ * alongside as SCM_RIGHTS, so file data never goes through the socket; each
+ * gets a RomwakReply. Every connection is served by a thread of its own,
+ * one request at a time. Cpu detection, a pool of kernel threads and up
+ * to CHUNK_CACHE_MAX chunk buffers stay warm in between.
+ */
+#ifdef ROMWAK_POSIX
+#define SERVE_MAX_FDS	(2*STREAM_MAX_PORTS)
+
+/* a live connection; the list lets shutdown wait for every one of them */
+typedef struct ServeConn {
+	int fd;
+	struct ServeConn *next;
+} ServeConn;
+
+static ServeConn *serveConns = NULL;
+static pthread_mutex_t serveLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t serveDone = PTHREAD_COND_INITIALIZER;
+
+/* SIGINT and SIGTERM write to a pipe the accept loop polls along with the
+ * socket, so a signal can't slip in between a check and the wait */
+static int servePipe[2] = { -1, -1 };
+
+static void ServeSignal(int sig){
+	int saved = errno;
+	char c = (char)sig;
+
+	if(write(servePipe[1],&c,1) < 0){
+		/* full already: a stop is pending either way */
+	}
+	errno = saved;
+}
+
+/* FullIo(int fd, void *data, size_t n, bool out) - Read or write all of n
+ * bytes on a socket. Returns the bytes done, short only at the end of the
+ * connection or on an error. */
+static size_t FullIo(int fd, void *data, size_t n, bool out){
+	size_t done = 0;
+	ssize_t r;
+
+	while(done < n){
+		r = out ? send(fd,(char*)data+done,n-done,0) : recv(fd,(char*)data+done,n-done,0);
+		if(r < 0 && errno == EINTR){
+			continue;
+		}
+		if(r <= 0){
+			break;
+		}
+		done += (size_t)r;
+	}
+	return done;
+}
+
+/* ServeReceive(int conn, RomwakRequest *req, int *fds, int *numFds)
+ * Receive the next request of a connection and the descriptors sent with it.
+ * Returns 1 for a request, 0 when the connection is done. */
+static int ServeReceive(int conn, RomwakRequest *req, int *fds, int *numFds){
+	struct msghdr msg;
+	struct iovec iov;
+	struct cmsghdr *c;
+	union {
+		struct cmsghdr align;
+		char buf[CMSG_SPACE(sizeof(int)*SERVE_MAX_FDS)];
+	} control;
+	ssize_t n;
+	int count;
+
+	memset(&msg,0,sizeof(msg));
+	iov.iov_base = req;
+	iov.iov_len = sizeof(RomwakRequest);
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control.buf;
+	msg.msg_controllen = sizeof(control.buf);
+	*numFds = 0;
+
+	do{
+		n = recvmsg(conn,&msg,0);
+	}while(n < 0 && errno == EINTR);
+	if(n <= 0){
+		return 0;
+	}
+	for(c=CMSG_FIRSTHDR(&msg);c!=NULL;c=CMSG_NXTHDR(&msg,c)){
+		if(c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_RIGHTS){
+			count = (int)((c->cmsg_len-CMSG_LEN(0))/sizeof(int));
+			if(count > SERVE_MAX_FDS-*numFds){
+				count = SERVE_MAX_FDS-*numFds;
+			}
+			memcpy(fds+*numFds,CMSG_DATA(c),count*sizeof(int));
+			*numFds += count;
+		}
+	}
+	/* descriptors only come with the first byte; the rest may trail */
+	if((size_t)n < sizeof(RomwakRequest)
+	&& FullIo(conn,(char*)req+n,sizeof(RomwakRequest)-(size_t)n,false) != sizeof(RomwakRequest)-(size_t)n){
+		for(count=0;count<*numFds;count++){
+			close(fds[count]);
+		}
+		return 0;
+	}
+	if(msg.msg_flags & MSG_CTRUNC){
+		req->op = 0;	/* more descriptors than any operation takes */
+	}
+	return 1;
+}
+
+/* ServeRequest(const RomwakRequest *req, int *fds, int numFds, RomwakReply *reply)
+ * Run one request on the descriptors that came with it. */
+static void ServeRequest(const RomwakRequest *req, int *fds, int numFds, RomwakReply *reply){
+	RomwakPort ports[SERVE_MAX_FDS];
+	int i;
+
+	memset(reply,0,sizeof(RomwakReply));
+	if(req->numIn < 0 || req->numOut < 0 || req->numIn > STREAM_MAX_PORTS
+	|| req->numOut > STREAM_MAX_PORTS || numFds != req->numIn+req->numOut){
+		reply->status = ROMWAK_EARGS;
+		return;
+	}
+	for(i=0;i<numFds;i++){
+		ports[i].fd = fds[i];
+		ports[i].data = NULL;
+		ports[i].length = 0;
+	}
+
+	errno = 0;
+	if(req->op == ROMWAK_SERVE_DIGEST){
+		reply->status = req->numIn == 1 && req->numOut == 0
+			? LibDigest(ports,(int)req->arg1,&reply->digests,false) : ROMWAK_EARGS;
+	}
+	else{
+		reply->status = LibRun(req->op,ports,req->numIn,ports+req->numIn,req->numOut,req->arg1,req->arg2,false);
+	}
+	reply->error = reply->status != ROMWAK_OK ? errno : 0;
+}
+
+static void *ServeConnection(void *arg){
+	ServeConn *self = (ServeConn*)arg, **link;
+	int conn = self->fd;
+	int fds[SERVE_MAX_FDS], numFds, i;
+	RomwakRequest req;
+	RomwakReply reply;
+
+	while(ServeReceive(conn,&req,fds,&numFds)){
+		ServeRequest(&req,fds,numFds,&reply);
+		for(i=0;i<numFds;i++){
+			close(fds[i]);
+		}
+		if(FullIo(conn,&reply,sizeof(RomwakReply),true) != sizeof(RomwakReply)){
+			break;
+		}
+	}
+
+	/* off the list before the descriptor is closed and can be reused */
+	pthread_mutex_lock(&serveLock);
+	for(link=&serveConns;*link!=self;link=&(*link)->next)
+		;
+	*link = self->next;
+	close(conn);
+	pthread_cond_signal(&serveDone);
+	pthread_mutex_unlock(&serveLock);
+	free(self);
+	return NULL;
+}
+
+/* ServeListen(char *path) - A listening socket at path, taking over the file
+ * of a daemon that is gone but not one that still answers. -1 on failure. */
+static int ServeListen(char *path){
+	struct sockaddr_un addr;
+	struct stat st;
+	int sock;
+
+	memset(&addr,0,sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path,path);
+
+	if(stat(path,&st) == 0 && S_ISSOCK(st.st_mode)){
+		sock = socket(AF_UNIX,SOCK_STREAM,0);
+		if(sock >= 0 && connect(sock,(struct sockaddr*)&addr,sizeof(addr)) == 0){
+			close(sock);
+			errno = EADDRINUSE;
+			return -1;
+		}
+		if(sock >= 0){
+			close(sock);
+		}
+		unlink(path);
+	}
+
+	sock = socket(AF_UNIX,SOCK_STREAM,0);
+	if(sock < 0){
+		return -1;
+	}
+	if(bind(sock,(struct sockaddr*)&addr,sizeof(addr)) != 0 || listen(sock,SOMAXCONN) != 0){
+		close(sock);
+		return -1;
+	}
+	return sock;
+}
+#endif
+
+/* ServeSocket(char *path) - /serve
+ * Serves requests on the Unix socket path until SIGINT or SIGTERM. Requests
+ * already running are finished and answered before it returns.
+ *
+ * (Params)
+ * char *path			Socket file to create
+ */
+int ServeSocket(char *path){
+#ifdef ROMWAK_POSIX
+	struct sigaction sa;
+	struct pollfd watch[2];
+	sigset_t quit, old;
+	pthread_attr_t attr;
+	pthread_t tid;
+	ServeConn *c;
+	int sock, conn;
+
+	if(strlen(path) >= sizeof(((struct sockaddr_un*)NULL)->sun_path)){
+		printf("Error socket path '%s' is too long.\n",path);
+		return EXIT_FAILURE;
+	}
+
+	/* set up now what requests would otherwise set up on their own */
+	CpuCount();
+	KernelPoolKeep(true);
+	ChunkKeep(CHUNK_CACHE_MAX);
+
+	if(pipe(servePipe) != 0){
+		perror("Error creating socket");
+		return EXIT_FAILURE;
+	}
+	fcntl(servePipe[1],F_SETFL,O_NONBLOCK);
+	sock = ServeListen(path);
+	if(sock < 0){
+		perror("Error creating socket");
+		close(servePipe[0]);
+		close(servePipe[1]);
+		return EXIT_FAILURE;
+	}
+
+	memset(&sa,0,sizeof(sa));
+	sa.sa_handler = ServeSignal;
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGINT,&sa,NULL);
+	sigaction(SIGTERM,&sa,NULL);
+	signal(SIGPIPE,SIG_IGN);	/* a client that hangs up fails its send instead */
+	/* only this thread takes the signals */
+	sigemptyset(&quit);
+	sigaddset(&quit,SIGINT);
+	sigaddset(&quit,SIGTERM);
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr,PTHREAD_CREATE_DETACHED);
+
+	printf("Serving on '%s' (threads: %d). Stop with Ctrl+C or SIGTERM.\n",path,CpuCount());
+	fflush(stdout);
+	watch[0].fd = sock;
+	watch[1].fd = servePipe[0];
+	watch[0].events = watch[1].events = POLLIN;
+	for(;;){
+		if(poll(watch,2,-1) < 0){
+			if(errno != EINTR){
+				perror("Error waiting for connections");
+				break;
+			}
+			continue;
+		}
+		if(watch[1].revents != 0){
+			break;
+		}
+		if(watch[0].revents == 0){
+			continue;
+		}
+		conn = accept(sock,NULL,NULL);
+		if(conn < 0){
+			if(errno != EINTR && errno != ECONNABORTED){
+				perror("Error accepting connection");
+			}
+			continue;
+		}
+		c = (ServeConn*)malloc(sizeof(ServeConn));
+		if(c == NULL){
+			close(conn);
+			continue;
+		}
+		c->fd = conn;
+		pthread_mutex_lock(&serveLock);
+		c->next = serveConns;
+		serveConns = c;
+		pthread_sigmask(SIG_BLOCK,&quit,&old);
+		if(pthread_create(&tid,&attr,ServeConnection,c) != 0){
+			perror("Error starting connection thread");
+			serveConns = c->next;
+			close(conn);
+			free(c);
+		}
+		pthread_sigmask(SIG_SETMASK,&old,NULL);
+		pthread_mutex_unlock(&serveLock);
+	}
+
+	close(sock);
+	unlink(path);
+	/* no more requests: connections end after the one they are running */
+	pthread_mutex_lock(&serveLock);
+	for(c=serveConns;c!=NULL;c=c->next){
+		shutdown(c->fd,SHUT_RD);
+	}
+	while(serveConns != NULL){
+		pthread_cond_wait(&serveDone,&serveLock);
+	}
+	pthread_mutex_unlock(&serveLock);
+
+	pthread_attr_destroy(&attr);
+	KernelPoolKeep(false);
+	ChunkKeep(0);
+	close(servePipe[0]);
+	close(servePipe[1]);
+	printf("Stopped serving on '%s'.\n",path);
+	return EXIT_SUCCESS;
+#else
+	printf("Error /serve needs Unix sockets, which this platform doesn't have ('%s').\n",path);
+	return EXIT_FAILURE;
+#endif
+}
+/*----------------------------------------------------------------------------*/
+
+/* RomwakCall(int sock, const RomwakRequest *req, const int *fds, RomwakReply *reply)
+ * Client side of /serve: send a request with its descriptors and wait for
+ * the reply. See libromwak.h.
+ */
+int RomwakCall(int sock, const RomwakRequest *req, const int *fds, RomwakReply *reply){
+#ifdef ROMWAK_POSIX
+	struct msghdr msg;
+	struct iovec iov;
+	struct cmsghdr *c;
+	union {
+		struct cmsghdr align;
+		char buf[CMSG_SPACE(sizeof(int)*SERVE_MAX_FDS)];
+	} control;
+	int numFds = req->numIn+req->numOut;
+	ssize_t n;
+
+	if(req->numIn < 0 || req->numOut < 0 || numFds > SERVE_MAX_FDS || (numFds > 0 && fds == NULL)){
+		return ROMWAK_EARGS;
+	}
+	memset(&msg,0,sizeof(msg));
+	iov.iov_base = (void*)req;
+	iov.iov_len = sizeof(RomwakRequest);
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	if(numFds > 0){
+		memset(&control,0,sizeof(control));
+		msg.msg_control = control.buf;
+		msg.msg_controllen = CMSG_SPACE(sizeof(int)*numFds);
+		c = CMSG_FIRSTHDR(&msg);
+		c->cmsg_level = SOL_SOCKET;
+		c->cmsg_type = SCM_RIGHTS;
+		c->cmsg_len = CMSG_LEN(sizeof(int)*numFds);
+		memcpy(CMSG_DATA(c),fds,sizeof(int)*numFds);
+	}
+
+	do{
+		n = sendmsg(sock,&msg,0);
+	}while(n < 0 && errno == EINTR);
+	if(n < 0 || ((size_t)n < sizeof(RomwakRequest)
+	&& FullIo(sock,(char*)req+n,sizeof(RomwakRequest)-(size_t)n,true) != sizeof(RomwakRequest)-(size_t)n)){
+		return ROMWAK_EWRITE;
+	}
+	errno = 0;
+	if(FullIo(sock,reply,sizeof(RomwakReply),false) != sizeof(RomwakReply)){
+		if(errno == 0){
+			errno = ECONNRESET;
+		}
+		return ROMWAK_EREAD;
+	}
+	errno = reply->error;
+	return reply->status;
+#else
+	(void)sock; (void)req; (void)fds; (void)reply;
+	return ROMWAK_EARGS;
+#endif
+}
+
+/*----------------------------------------------------------------------------*/
+
+/* RunCommand(int argc, char* argv[]) - Runs one command, argv laid out
+ * like main()'s. Used by main() and by each line of a /batch manifest. */
+int RunCommand(int argc, char* argv[]){
+	/* command line argument parsing (originally in ROMWAK.DPR) */
+	/* The original program used /switches, but this port allows shorthand
+	 * switches with a '-' as well, for people who aren't on Windows. */
+	if(argv[1][0] != '/' && argv[1][0] != '-'){
+		printf("ERROR: Invalid command %s\n\n",argv[1]);
+		Usage();
+		return EXIT_FAILURE; /* command syntax is wrong, broheim */
+	}
+	else if(argc < CommandArgs(argv[1])){
+		printf("ERROR: Too few arguments for %s\n\n",argv[1]);
+		Usage();
+		return EXIT_FAILURE;
+	}
+	else if(strcmp(&argv[1][1],"darksoft") == 0){
+		/* checked before the switch: /d would otherwise claim it */
+		return DarksoftSet(argv[2],argv[3],argc > 4 ? argv[4] : NULL);
+	}
+	else if(strcmp(&argv[1][1],"serve") == 0){
+		/* checked before the switch: /s would otherwise claim it */
+		return ServeSocket(argv[2]);
+	}
+	else{
+		switch(argv[1][1]){
+			case 'b': /* split file in two, alternating bytes */
+				return ByteSplit(argv[2],argv[3],argv[4]);
+
+			case 'c': /* concatenate two file2 */
+				return ConcatFiles(argv[2], argv[3], argv[4]);
+
+			case 'd': /* concatenate crom files ala Darksoft */
+				return DarksoftConcatFiles(argv[2], argv[3], argv[4]);
+
+			case 'e': /* concatenate prom files ala Darksoft */
+				return ConcatFilesEx(argv[2], argv[3], argv[4]);
+
+			case 'f': /* flip low/high bytes */
+				return FlipByte(argv[2],argv[3],argv[1][2] != '\0' ? atoi(&argv[1][2]) : 16);
+
+			case 'h': /* split file in half (two files) */
+				return EqualSplit(argv[2],argv[3],argv[4]);
+
+			case 'i': /* rom information (size,crc) */
+				return InfoFile(argv[2], argv[3], &argv[4], argc - 4 > 0 ? argc - 4 : 0);
+
+			case 'l': /* split file into N files by lanes of K bytes */
+				return LaneSplit(argv[4],&argv[5],argv[2],argv[3]);
+
+			case 'm': /* byte merge two files */
+				return MergeBytes(argv[2],argv[3],argv[4]);
+
+			case 'q': /* byte merge four files */
+				return MergeBytesQuad(argv[2],argv[3],argv[4],argv[5],argv[6]);
+
+			case 's': /* swap top and bottom halves of a file */
+				if(argv[1][2] == 'i'){
+					return SwapHalfInPlace(argv[2]);
+				}
+				return SwapHalf(argv[2],argv[3]);
+
+			case 'u': /* byte update two files with size */
+				return UpdateBytes(argv[2], argv[3], argv[4], argv[5], argc > 6 ? argv[6] : NULL);
+
+			case 'w': /* split file in two, alternating words */
+				return WordSplit(argv[2],argv[3],argv[4]);
+
+			case 'p': /* pad file */
+				return PadFile(argv[2],argv[3],argv[4],argv[5]);
+
+			case 'z': /* merge N files by lanes of K bytes */
+				return LaneMerge(&argv[4],argv[2],argv[3]);
+
+			default:
+				/* option does not exist */
+				printf("ERROR: Option '/%c' doesn't exist.\n",argv[1][1]);
+				return EXIT_FAILURE;
+		}
+	}
+
+	/* should not get here, but if it does, let's not make a fuss. */
+	return EXIT_SUCCESS;
+}
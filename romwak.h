@@ -3,6 +3,8 @@ typedef int bool;
 #define false	0
 #define true	1
 
+#define ROMWAK_VERSION	"0.7" /* derived from 0.4 source code; see romwak.c */
+
 /* romwak function prototypes */
 
 /* Print usage */
@@ -12,11 +14,180 @@ void Usage();
 int EqualSplit(char *fileIn, char *fileOutA, char *fileOutB);
 int ByteSplit(char *fileIn, char *fileOutA, char *fileOutB);
 int WordSplit(char *fileIn, char *fileOutA, char *fileOutB);
-int FlipByte(char *fileIn, char *fileOut);
+int FlipByte(char *fileIn, char *fileOut, int width);
 int MergeBytes(char *fileIn1, char *fileIn2, char *fileOut);
 int SwapHalf(char *fileIn, char *fileOut);
+int SwapHalfInPlace(char *fileIn);
 int PadFile(char *fileIn, char *fileOut, char *padSize, char *padByte);
+int LaneSplit(char *fileIn, char **fileOut, char *ways, char *lane);
+int LaneMerge(char **fileIn, char *ways, char *lane);
+int DarksoftSet(char *setDir, char *outDir, char *fpga);
+int BatchFile(char *fileIn);
+int ServeSocket(char *path);
+int RunCommand(int argc, char *argv[]);
 
 /* [Helper Functions] */
 bool FileExists(char *fileIn);
+bool ParseLong(const char *text, int base, long *value);
 long FileSize(FILE *pFile);
+bool ParseLaneFormat(char *ways, char *lane, int *numWays, int *laneSize);
+
+/* [Streaming Engine] */
+#define STREAM_CHUNK		(1024*1024)	/* largest buffer allocated per port */
+#define STREAM_MAX_PORTS	8
+#define STREAM_QUEUE		4	/* buffers per port with asynchronous writes or pipelining */
+#define PIPE_MIN_PASSES		4	/* shorter transforms aren't worth the threads */
+#define KERNEL_MAX_THREADS	64
+#define KERNEL_PART_MIN		(64*1024)	/* least output per kernel thread and chunk */
+#define KERNEL_ALIGN		64	/* kernel threads split outputs on cache lines */
+#define KERNEL_COPY_MIN		(64*1024)	/* smaller copies go through StreamRead/StreamWrite */
+#define SPARSE_FILL_MIN		(64*1024)	/* shorter runs of zeros are written out */
+#define PREFETCH_MAX		(512L*1024*1024)	/* inputs of a job loaded concurrently, in total */
+#define PREFETCH_PAGE		4096
+#define CHUNK_CACHE_MAX		32	/* released chunks kept for reuse by /serve */
+
+/* in-memory file, named "@name" in a /batch manifest */
+typedef struct MemFile {
+	char *name;
+	unsigned char *data;
+	long length;
+	long size;				/* allocated bytes */
+	bool fixed;				/* data is a caller's buffer: never grown, freed or named */
+	struct MemFile *next;
+} MemFile;
+
+typedef struct {
+	char *path;
+	const char *what;		/* description for error messages */
+	FILE *file;
+	long length;
+	long pos;
+	unsigned char *buf;
+	const unsigned char *map;	/* whole file, when it could be mapped */
+	MemFile *mem;			/* set when reading an in-memory file */
+	void *prefetch;			/* background loader, see JobPrefetch() */
+} StreamIn;
+
+typedef struct {
+	char *path;
+	const char *what;		/* description for error messages */
+	char *tempPath;			/* set when replacing one of the job's inputs */
+	FILE *file;
+	long pos;
+	unsigned char *buf;
+	MemFile *mem;			/* set when writing an in-memory file */
+	unsigned char *queue[STREAM_QUEUE];	/* buffers, buf is queue[slot] */
+	int slot;
+	int busy[STREAM_QUEUE];	/* asynchronous writes in flight per buffer */
+	int pending;			/* asynchronous writes in flight in total */
+	int ioError;			/* errno of a failed asynchronous write */
+	bool direct;			/* stdio position is behind the asynchronous writes */
+} StreamOut;
+
+typedef struct {
+	StreamIn in[STREAM_MAX_PORTS];
+	int numIn;
+	StreamOut out[STREAM_MAX_PORTS];
+	int numOut;
+	bool failed;
+	bool noMap;				/* read inputs, never map them (see LibRun()) */
+	char error[128];		/* failed step, for perror() */
+	int errorClass;			/* JOB_ERROR_* of the failed step */
+	void *ring;				/* io_uring for asynchronous writes, when in use */
+} StreamJob;
+
+/* what JobError() recorded a job failing at */
+#define JOB_ERROR_WRITE		0
+#define JOB_ERROR_READ		1
+#define JOB_ERROR_MEMORY	2
+
+/* src: one chunk per input, dst: one buffer per output */
+typedef void (*StreamKernel)(const unsigned char **src, unsigned char **dst, long units, const void *ctx);
+
+void JobInit(StreamJob *job);
+void JobError(StreamJob *job, const char *action, const char *what);
+StreamIn *JobInput(StreamJob *job, char *fileIn, const char *what);
+StreamIn *JobInputFd(StreamJob *job, int fd, const char *what);
+StreamIn *JobInputBuffer(StreamJob *job, const unsigned char *data, long length, const char *what);
+void MapInput(StreamIn *s);
+void UnmapInput(StreamIn *s);
+void JobPrefetch(StreamJob *job);
+void PrefetchStop(StreamIn *s);
+StreamOut *JobOutput(StreamJob *job, char *fileOut, const char *what);
+StreamOut *JobOutputFd(StreamJob *job, int fd, const char *what);
+StreamOut *JobOutputBuffer(StreamJob *job, unsigned char *data, long size, const char *what);
+int JobOutputTruncate(StreamJob *job, StreamOut *s);
+int JobClose(StreamJob *job);
+void JobCloseInputs(StreamJob *job);
+int JobFail(StreamJob *job);
+int StreamRead(StreamJob *job, StreamIn *s, size_t n, const unsigned char **data);
+int StreamSeek(StreamJob *job, StreamIn *s, long offset);
+unsigned char *StreamBuffer(StreamJob *job, StreamOut *s);
+int StreamWrite(StreamJob *job, StreamOut *s, const unsigned char *data, size_t n);
+int StreamSubmit(StreamJob *job);
+int StreamSettle(StreamJob *job, StreamOut *s);
+long KernelCopy(StreamJob *job, StreamIn *in, StreamOut *out, long length);
+int StreamCopy(StreamJob *job, StreamIn *in, StreamOut *out, long length);
+int StreamPatch(StreamJob *job, StreamIn *in, StreamOut *out, long offset, long length);
+int StreamFill(StreamJob *job, StreamOut *out, unsigned char value, long length);
+int StreamTransform(StreamJob *job, size_t inUnit, size_t outUnit, long units, StreamKernel kernel, const void *ctx);
+void ChunkKeep(int chunks);
+void KernelPoolKeep(bool keep);
+bool SameLengths(StreamJob *job);
+void MemFileEnable(bool enable);
+bool MemFileName(const char *path);
+MemFile *MemFileFind(const char *name);
+void MemFilePublish(MemFile *file, bool keep);
+void MemFileDrop(const char *name);
+
+/* [SIMD Kernels] */
+#define CPU_SSE2	0x01
+#define CPU_AVX2	0x02
+#define CPU_NEON	0x04
+#define CPU_SSSE3	0x08
+#define CPU_CLMUL	0x10
+
+int CpuFeatures(void);
+int CpuCount(void);
+void CpuCountSet(int threads);
+void CpuDispatchAll(void);
+extern void (*DeinterleaveBytes)(const unsigned char *in, unsigned char *outA, unsigned char *outB, long count);
+void DeinterleaveBytesScalar(const unsigned char *in, unsigned char *outA, unsigned char *outB, long count);
+extern void (*DeinterleaveWords)(const unsigned char *in, unsigned char *outA, unsigned char *outB, long count);
+void DeinterleaveWordsScalar(const unsigned char *in, unsigned char *outA, unsigned char *outB, long count);
+extern void (*InterleaveBytes)(const unsigned char *inA, const unsigned char *inB, unsigned char *out, long count);
+void InterleaveBytesScalar(const unsigned char *inA, const unsigned char *inB, unsigned char *out, long count);
+extern void (*InterleaveBytesQuad)(const unsigned char **in, unsigned char *out, long count);
+void InterleaveBytesQuadScalar(const unsigned char **in, unsigned char *out, long count);
+extern void (*SwapBytes)(const unsigned char *in, unsigned char *out, long count, int width);
+void SwapBytesScalar(const unsigned char *in, unsigned char *out, long count, int width);
+extern long (*CrcFold)(const unsigned char *data, long length, unsigned long crc, int reflected, unsigned char *rem);
+long CrcFoldScalar(const unsigned char *data, long length, unsigned long crc, int reflected, unsigned char *rem);
+
+/* [Lane Engine] */
+#define LANE_MAX_WAYS	STREAM_MAX_PORTS
+#define LANE_MAX_WIDTH	64
+
+/* count is the number of groups of ways lanes */
+typedef void (*LaneSplitFn)(const unsigned char *in, unsigned char **out, long count);
+typedef void (*LaneMergeFn)(const unsigned char **in, unsigned char *out, long count);
+
+typedef struct {
+	int ways;				/* number of split files */
+	int lane;				/* bytes per lane */
+	LaneSplitFn split;		/* specialized kernels, NULL for the generic loop */
+	LaneMergeFn merge;
+} LaneFormat;
+
+void LaneFormatInit(LaneFormat *fmt, int ways, int lane);
+void SplitLanesKernel(const unsigned char **src, unsigned char **dst, long units, const void *ctx);
+void MergeLanesKernel(const unsigned char **src, unsigned char **dst, long units, const void *ctx);
+int StreamSplitLanes(StreamJob *job, const LaneFormat *fmt);
+int StreamMergeLanes(StreamJob *job, const LaneFormat *fmt);
+void FlipBytesKernel(const unsigned char **src, unsigned char **dst, long units, const void *ctx);
+int StreamFlip(StreamJob *job, int size);
+int StreamSplitHalf(StreamJob *job);
+int StreamSwapHalf(StreamJob *job);
+int StreamConcat(StreamJob *job, long split);
+int SplitLanes(char *fileIn, char **fileOut, int ways, int lane);
+int MergeLanes(char **fileIn, int ways, int lane, char *fileOut);